@@ -3,6 +3,9 @@
 #ifdef WIN32
 #include <windows.h>
 #endif
+#ifdef UNIX
+#include <time.h>
+#endif
 
 namespace rtb {
 
@@ -41,6 +44,36 @@ namespace rtb {
 		tt -= 11644473600000000ULL;
 		timeNow = tt;
 		timeNow = timeNow / 1000000;
+#endif
+		return timeNow;
+	}
+
+	/**
+	 * @brief CPU time (user + kernel) consumed by the calling thread, in seconds.
+	*/
+	inline double getThreadCPUTime()
+	{
+		double timeNow = 0;
+#ifdef UNIX
+		struct timespec now;
+
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+		timeNow = (now.tv_sec) + 0.000000001 * now.tv_nsec;
+#endif
+#ifdef WIN32
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			unsigned long long kt = kernelTime.dwHighDateTime;
+			kt <<= 32;
+			kt |= kernelTime.dwLowDateTime;
+			unsigned long long ut = userTime.dwHighDateTime;
+			ut <<= 32;
+			ut |= userTime.dwLowDateTime;
+			// FILETIME is in 100 ns units
+			timeNow = double(kt + ut) / 10000000;
+		}
 #endif
 		return timeNow;
 	}
@@ -1,5 +1,8 @@
 #include "QualisysConnection.h"
 
+#include <algorithm>
+#include <ctime>
+
 
 
 QualisysConnection::QualisysConnection()
@@ -18,6 +21,7 @@ QualisysConnection::QualisysConnection(std::string ip, unsigned short port)
 
 QualisysConnection::~QualisysConnection()
 {
+    delete poseServer_;
 }
 
 int QualisysConnection::connectTCP()
@@ -64,6 +68,40 @@ int QualisysConnection::setControlGUICapture(std::string password)
 }
 
 
+int QualisysConnection::startPoseServer(const std::string& multicastAddress, unsigned short udpPort, unsigned short tcpPort, double rate)
+{
+    if (poseServer_)
+    {
+        printf("[!!] Pose server already started.\n");
+        return -1;
+    }
+
+    poseServer_ = new QualisysPoseServer();
+    poseServer_->setBodies(rigidbodyName_);
+
+    // start what the user asked for, udp and/or tcp
+    int status = 0;
+    if (!multicastAddress.empty())
+        status |= poseServer_->startUDP(multicastAddress, udpPort);
+    if (tcpPort != 0)
+        status |= poseServer_->startTCP(tcpPort);
+
+    if (status != 0)
+    {
+        delete poseServer_;
+        poseServer_ = nullptr;
+        return -1;
+    }
+
+    // the server is just another consumer of the frames, at the rate the user asked for
+    QualisysPoseServer* server = poseServer_;
+    fanout_.addSink("pose server", rate, QualisysFanout::DECIMATE_USING_LATEST,
+        [server](const double& timePC, const double& timeQ, const std::vector<double>& data) { server->publish(timePC, timeQ, data); });
+
+    return 0;
+}
+
+
 int QualisysConnection::readMarkerSettings() 
 {
     // read the rigid body settings
@@ -111,7 +149,26 @@ int QualisysConnection::receiveData()
         // variable to capture packet event from qualisys
         CRTPacket::EEvent ePacketEvent;
         
-        if (poRTProtocol_.GetState(ePacketEvent, true, 1)) //1ms
+        // before the capture starts, ask QTM for its state once (the capture may already run, or its event may have
+        // been consumed by StartCapture()), then there is nothing else to do than waiting for the event QTM sends by
+        // itself, so just wait on the socket as long as the wait strategy decides (asking would be replied right away).
+        // after the capture started, keep asking (1us), the frames are received below.
+        bool gotEvent;
+        if (userstart_)
+        {
+            gotEvent = poRTProtocol_.GetState(ePacketEvent, true, 1);
+        }
+        else if (!stateAsked_)
+        {
+            stateAsked_ = true;
+            gotEvent = poRTProtocol_.GetState(ePacketEvent, true, this->waitTimeout());
+        }
+        else
+        {
+            gotEvent = poRTProtocol_.GetState(ePacketEvent, false, this->waitTimeout());
+        }
+
+        if (gotEvent)
         {
             if (ePacketEvent == CRTPacket::EEvent::EventCaptureStarted && !userstart_)
             {
@@ -119,6 +176,7 @@ int QualisysConnection::receiveData()
                 // (!) START RECORDING FOR EVERY OTHER DEVICE
                 synch::start();
                 userstart_ = true;
+                idle_ = false;
             }
 
             //If qualisys recording stopped we also stop the software
@@ -128,6 +186,8 @@ int QualisysConnection::receiveData()
                 std::cout << "[>>] Qualisys recording stopped." << std::endl;
                 synch::setStop(true);
                 userstart_ = false;
+                stateAsked_ = false;
+                idle_ = false;
             }
         }
     }
@@ -138,15 +198,16 @@ int QualisysConnection::receiveData()
         // variable to capture packettype (error/packetdata/end)
         CRTPacket::EPacketType ePacketType;
 
-        // get a frame
-        unsigned int nComponentType = CRTProtocol::cComponent6d;
+        // get a frame, 6DoF with residuals (the residuals are used to monitor the quality of the data)
+        unsigned int nComponentType = CRTProtocol::cComponent6dRes;
         poRTProtocol_.GetCurrentFrame(nComponentType);
         // get a packet
         CRTPacket* rtPacket = poRTProtocol_.GetRTPacket();
         // Get the PC timeframe
         timeStamp_ = rtb::getTime();
 
-        // check if receiving data is a success
+        // check if receiving data is a success. GetCurrentFrame is a request/response, so always wait with the
+        // default timeout of the SDK, a reply arriving late would otherwise be read as the reply of the next request.
         if (poRTProtocol_.Receive(ePacketType, true) == CNetwork::ResponseType::success)
         {
             // let's check type of data we got..
@@ -167,19 +228,22 @@ int QualisysConnection::receiveData()
                     // if we received data, let's do our bussiness
                 case CRTPacket::PacketData:
 
+                    idle_ = false;
                     float fX, fY, fZ;
                     float afRotMatrix[9];
+                    float fResidual;
 
                     // only concern if the packet arrived is in size with our expectation i.e. rigid body size
-                    if (rtPacket->GetComponentSize(CRTPacket::Component6d))
+                    if (rtPacket->GetComponentSize(CRTPacket::Component6dRes))
                     {
                         // get how much number of 6DoF body we received
-                        unsigned int nCount = rtPacket->Get6DOFBodyCount();
+                        unsigned int nCount = rtPacket->Get6DOFResidualBodyCount();
                         // we only concern if we really get some value
                         if (nCount > 0)
                         {
                             // clear the vector before inserting new data
                             rigidbodyData_.clear();
+                            residuals_.clear();
 
                             // get timestamp from Qualisys Packet
                             unsigned long long timestampQualisysInt = rtPacket->GetTimeStamp();
@@ -192,7 +256,8 @@ int QualisysConnection::receiveData()
                                 // get rigid body names
                                 char* label = (char*)poRTProtocol_.Get6DOFBodyName(i);
                                 // get the rigid body values
-                                rtPacket->Get6DOFBody(i, fX, fY, fZ, afRotMatrix);
+                                rtPacket->Get6DOFResidualBody(i, fX, fY, fZ, afRotMatrix, fResidual);
+                                residuals_.push_back(fResidual);
 
                                 // using eigen to convert rotation matrix to quaternion
                                 Eigen::Matrix3f RotM{ {afRotMatrix[0], afRotMatrix[1], afRotMatrix[2]},
@@ -216,11 +281,11 @@ int QualisysConnection::receiveData()
 
                             }
 
-                            // if the user decided to log, logging here
-                            if (record_)
-                            {
-                                logger_->log(Logger::LogID::RigidBody, timeStamp_, timeStampQualisys_, rigidbodyData_);
-                            }
+                            // monitor the quality before anything else, so lost bodies and skipped frames are noticed during the recording
+                            monitor_.update(rtPacket->GetFrameNumber(), rigidbodyData_, residuals_);
+
+                            // hand the frame to every sink (logger, UI, network...), each one at its own rate
+                            fanout_.push(rtPacket->GetFrameNumber(), timeStamp_, timeStampQualisys_, rigidbodyData_);
                         }
                     }
                     break;
@@ -246,15 +311,89 @@ int QualisysConnection::receiveData()
 }
 
 
+void QualisysConnection::logData(const double& timePC, const double& timeQ, const std::vector<double>& data)
+{
+    logger_->log(Logger::LogID::RigidBody, timePC, timeQ, data);
+
+    // keep the manifest of the session up to date
+    if (manifest_.frameCount == 0)
+    {
+        std::time_t now = std::time(nullptr);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        manifest_.startTime = buffer;
+        manifest_.startTimePC = timePC;
+        manifest_.firstTimeQ = timeQ;
+    }
+    manifest_.lastTimeQ = timeQ;
+    manifest_.frameCount++;
+}
+
+
+int QualisysConnection::waitTimeout()
+{
+    switch (waitStrategy_)
+    {
+        // block at most one frame period, so we still check ESC and stop signal regularly
+        case QualisysConnection::WAIT_USING_BLOCKING:
+            return (frameRate_ > 0) ? std::max(1, int(1e6 / frameRate_)) : 10000;
+
+        // poll the socket as short as possible (1us)
+        case QualisysConnection::WAIT_USING_SPIN:
+        case QualisysConnection::WAIT_USING_SPIN_THEN_YIELD:
+        default:
+            return 1;
+    }
+}
+
+
+void QualisysConnection::waitIdle()
+{
+    spinCount_++;
+
+    // only WAIT_USING_SPIN_THEN_YIELD needs to do something here, WAIT_USING_SPIN just loops again and
+    // WAIT_USING_BLOCKING already waited on the socket.
+    if (waitStrategy_ == QualisysConnection::WAIT_USING_SPIN_THEN_YIELD && spinCount_ > spinLimit_)
+    {
+        std::this_thread::yield();
+    }
+}
+
+
 void QualisysConnection::operator()()
 {
     // if user specified record, create new log using QualisysLogger (inherited from OpenSimFileLogger)
     if (record_)
     {
-        logger_ = new QualisysLogger(recordDirectory_);
-        logger_->addLog(Logger::LogID::RigidBody, rigidbodyName_);
+        // every recording gets its own session directory, so re-running never overwrites a previous recording
+        manifest_ = QualisysSession::sessionManifest();
+        manifest_.directory = QualisysSession::createDirectory(recordDirectory_, manifest_.name);
+        if (manifest_.directory.empty())
+        {
+            printf("[!!] Recording disabled, no session directory could be created in %s.\n", recordDirectory_.c_str());
+            record_ = false;
+        }
+        else
+        {
+            manifest_.dataFile = "rigidbody.trc2";
+            manifest_.bodies = rigidbodyName_;
+            manifest_.frameRate = frameRate_;
+            manifest_.indexInterval = indexInterval_;
+
+            logger_ = new QualisysLogger(manifest_.directory);
+            logger_->setIndexInterval(indexInterval_);
+            logger_->addLog(Logger::LogID::RigidBody, rigidbodyName_);
+            printf("[OK] Recording session %s in %s\n", manifest_.name.c_str(), manifest_.directory.c_str());
+
+            // the archive wants every frame
+            fanout_.addSink("logger", 0, QualisysFanout::DECIMATE_USING_LATEST,
+                [this](const double& timePC, const double& timeQ, const std::vector<double>& data) { this->logData(timePC, timeQ, data); });
+        }
     }
 
+    // start the quality statistics from zero for this streaming
+    monitor_.setBodies(rigidbodyName_);
+
     // If user specified to control QTM GUI from CMD to record, it automatically uses STREAM_USING_COMMAND,
     // which will execute the start capture command. 
     if (streamMode_ == QualisysConnection::STREAM_USING_COMMAND)
@@ -298,11 +437,39 @@ void QualisysConnection::operator()()
  
     // a flag if there is a condition that terminates the connection
     int streamingstatus=-1;
+    // statistics of the loop, to report how much the wait strategy costs
+    const char* strategyNames[] = { "WAIT_USING_SPIN", "WAIT_USING_SPIN_THEN_YIELD", "WAIT_USING_BLOCKING" };
+    printf("[>>] Wait strategy: %s (expected frame rate %.1f Hz).\n", strategyNames[waitStrategy_], frameRate_);
+    waitStatistics_ = {};
+    waitStatistics_.strategy = waitStrategy_;
+    double wallStart = rtb::getTime();
+    double cpuStart = rtb::getThreadCPUTime();
+    // ask QTM for its state when the wait starts, after StartCapture() if it was commanded
+    stateAsked_ = false;
     // as long as there is no stopping signal from every other device, keep receiving data 
     while (!synch::getStop() && !userquit_) {
         // receive the data
+        idle_ = true;
         streamingstatus = this->receiveData();
+
+        // if nothing arrived, let the wait strategy decide what to do
+        waitStatistics_.loops++;
+        if (idle_) {
+            waitStatistics_.idleLoops++;
+            this->waitIdle();
+        } else {
+            spinCount_ = 0;
+        }
     }
+    waitStatistics_.wallTime = rtb::getTime() - wallStart;
+    waitStatistics_.cpuTime = rtb::getThreadCPUTime() - cpuStart;
+    waitStatistics_.cpuUsage = (waitStatistics_.wallTime > 0) ? waitStatistics_.cpuTime / waitStatistics_.wallTime : 0;
+    printf("[OK] Wait strategy: %s, loops: %llu (idle: %llu), CPU usage: %.1f%% of a core (%.2fs CPU in %.2fs).\n",
+        strategyNames[waitStrategy_], waitStatistics_.loops, waitStatistics_.idleLoops,
+        100 * waitStatistics_.cpuUsage, waitStatistics_.cpuTime, waitStatistics_.wallTime);
+    fanout_.flush();
+    fanout_.report();
+    monitor_.report();
     // =========================================================================================================
 
 
@@ -349,4 +516,56 @@ void QualisysConnection::operator()()
             synch::setStop(true);
         }
     }
+
+    // disconnect the clients of the pose server
+    if (poseServer_)
+    {
+        poseServer_->stop();
+        poseServer_->report();
+    }
+
+    // if the user specified record, close the session properly
+    if (record_)
+    {
+        this->finishRecording();
+    }
+}
+
+
+void QualisysConnection::finishRecording()
+{
+    // make sure everything is on the disk before writing the index which points into the file
+    logger_->finish();
+
+    // the rate actually measured from the Qualisys timestamps
+    if (manifest_.frameCount > 1 && manifest_.lastTimeQ > manifest_.firstTimeQ)
+    {
+        manifest_.measuredFrameRate = double(manifest_.frameCount - 1) / (manifest_.lastTimeQ - manifest_.firstTimeQ);
+    }
+
+    // summary of the quality of the data
+    QualisysQualityMonitor::qualityStatistics quality = monitor_.getStatistics();
+    manifest_.skippedFrames = quality.skippedFrames;
+    manifest_.alerts = quality.alerts;
+    manifest_.visibility.clear();
+    manifest_.longestGap.clear();
+    manifest_.residualMean.clear();
+    manifest_.residualMax.clear();
+    for (std::vector<QualisysQualityMonitor::bodyStatistics>::const_iterator it = quality.bodies.begin(); it != quality.bodies.end(); it++)
+    {
+        manifest_.visibility.push_back(it->visibilityRatio);
+        manifest_.longestGap.push_back(double(it->longestGap));
+        manifest_.residualMean.push_back(it->residualMean);
+        manifest_.residualMax.push_back(it->residualMax);
+    }
+
+    if (QualisysSession::writeIndex(manifest_.directory, logger_->getIndex()) == 0 &&
+        QualisysSession::writeManifest(manifest_) == 0)
+    {
+        printf("[OK] Session %s saved (%llu frames).\n", manifest_.name.c_str(), manifest_.frameCount);
+    }
+    else
+    {
+        printf("[!!] Something wrong happened when saving the manifest of session %s.\n", manifest_.name.c_str());
+    }
 }
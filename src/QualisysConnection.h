@@ -11,6 +11,14 @@
 
 // a class that inherit OpenSimFileLogger for logging data (from guillaume)
 #include "QualisysLogger.h"
+// a class for managing the recorded sessions (manifest and index of every recording)
+#include "QualisysSession.h"
+// a class for distributing the frames to several consumers, each one at its own rate
+#include "QualisysFanout.h"
+// a class for re-broadcasting the frames to other machines (UDP multicast / TCP)
+#include "QualisysPoseServer.h"
+// a class for monitoring the quality of the data (lost bodies, skipped frames, residuals)
+#include "QualisysQualityMonitor.h"
 // a class for maintaining synchronization start and stop for all devices
 #include "Synch.h"
 #include "getTime.h"
@@ -21,6 +29,8 @@
 // https://www.boost.org/users/download/
 #include <boost/filesystem.hpp>
 
+#include <thread>
+
 
 #ifdef _WIN32
 #define sleep Sleep
@@ -75,6 +85,23 @@ public:
         return recordDirectory_;
     }
 
+    /**
+     * @brief Get the directory of the last recorded session (a sub-directory of the record directory).
+    */
+    std::string getSessionDirectory()
+    {
+        return manifest_.directory;
+    }
+
+    /**
+     * @brief Set every how many frames an entry is added to the session index.
+     * @param interval Number of frames (100).
+    */
+    void setIndexInterval(unsigned int interval)
+    {
+        indexInterval_ = interval;
+    }
+
     /**
      * @brief Set function to record the data
      * @param flag boolean.
@@ -92,6 +119,78 @@ public:
         return record_;
     }
 
+    /**
+     * @brief Add a consumer of the rigid body frames.
+     *
+     * The frames are delivered from the streaming thread, tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body
+     * (in the order of getRigidbodyName()). If recording, the logger is added automatically at full rate.
+     * Add the consumers before starting the streaming thread, the list is not protected while streaming.
+     *
+     * @param name Name of the consumer, used for reporting.
+     * @param rate Rate needed by the consumer in Hz, 0 to receive every frame.
+     * @param mode DECIMATE_USING_LATEST to receive the latest frame, DECIMATE_USING_AVERAGE to receive the average of the period.
+     * @param function Function receiving the frames.
+    */
+    int addSink(const std::string& name, double rate, QualisysFanout::enumDecimationModes mode, QualisysFanout::sinkFunction function)
+    {
+        return fanout_.addSink(name, rate, mode, function);
+    }
+
+    /**
+     * @brief Re-broadcast the frames to other machines, so they don't need their own connection to QTM.
+     *
+     * The frames are sent as QualisysPosePacket, and can be received with QualisysPoseClient.
+     * Start it before starting the streaming thread, it is added as a consumer (see addSink()).
+     *
+     * @param multicastAddress UDP multicast group (e.g. 239.255.42.99), empty for no UDP.
+     * @param udpPort UDP port of the group.
+     * @param tcpPort TCP port for the clients needing a reliable delivery, 0 for no TCP.
+     * @param rate Rate of the re-broadcast in Hz (for both UDP and TCP), 0 to send every frame.
+     * @return 0 success, -1 error occured.
+    */
+    int startPoseServer(const std::string& multicastAddress, unsigned short udpPort, unsigned short tcpPort, double rate = 0);
+
+    /**
+     * @brief Get the names of the rigid bodies, in the order of the data.
+    */
+    std::vector<std::string> getRigidbodyName()
+    {
+        return rigidbodyName_;
+    }
+
+    /**
+     * @brief Set the thresholds of the quality monitor raising alerts during streaming, a threshold of 0 is disabled.
+     *
+     * @param minVisibility Minimum visibility ratio of a rigid body over the recent frames (0.9).
+     * @param maxGap Number of consecutive frames a rigid body can be lost before an alert (100).
+     * @param maxResidual Maximum residual of a rigid body in mm (0).
+     * @param maxSkippedFrames Number of frame numbers skipped at once which raises an alert (10). The frames are polled,
+     *                         so skipped frames usually mean the streaming loop is too slow for the capture rate.
+    */
+    void setQualityThresholds(double minVisibility, unsigned long long maxGap, double maxResidual, unsigned long long maxSkippedFrames)
+    {
+        monitor_.setThresholds(minVisibility, maxGap, maxResidual, maxSkippedFrames);
+    }
+
+    /**
+     * @brief Set the function called when the quality monitor raises an alert, by default the alert is printed.
+     *
+     * The function is called by the streaming thread, so it should be quick (it delays the next frame). It can call
+     * getQualityStatistics(). Set it before starting the streaming thread.
+    */
+    void setQualityAlert(QualisysQualityMonitor::alertFunction function)
+    {
+        monitor_.setAlertFunction(function);
+    }
+
+    /**
+     * @brief Get the statistics of the quality monitor (visibility, gaps, residuals, skipped frames), can be called while streaming.
+    */
+    QualisysQualityMonitor::qualityStatistics getQualityStatistics()
+    {
+        return monitor_.getStatistics();
+    }
+
     /**
      * @brief Overloading operator().
      * 
@@ -120,6 +219,62 @@ public:
         streamMode_ = mode;
     }
 
+
+    enum enumWaitStrategies {
+        WAIT_USING_SPIN,
+        WAIT_USING_SPIN_THEN_YIELD,
+        WAIT_USING_BLOCKING
+    };
+
+    /**
+     * @brief Set function to specify how the main loop waits when there is no data
+     *
+     * There are 3 strategies currently available:
+     * WAIT_USING_SPIN keeps polling the socket as fast as possible, lowest latency but burns a full core.
+     * WAIT_USING_SPIN_THEN_YIELD polls, but gives the core away to other threads after a number of idle loops.
+     * WAIT_USING_BLOCKING blocks on the socket with a timeout derived from the expected frame period.
+     *
+     * The strategy applies while waiting for QTM to start capturing (STREAM_USING_MANUAL_BUTTON). Once capturing,
+     * every frame is requested and its reply waited for with the default timeout of the SDK.
+     *
+    */
+    void setWaitStrategy(QualisysConnection::enumWaitStrategies strategy)
+    {
+        waitStrategy_ = strategy;
+    }
+
+    /**
+     * @brief Set the expected frame rate of QTM, used to derive the timeout of WAIT_USING_BLOCKING.
+     * @param frameRate Frame rate in Hz, must be positive (otherwise ignored).
+    */
+    void setFrameRate(double frameRate)
+    {
+        if (frameRate > 0)
+            frameRate_ = frameRate;
+        else
+            printf("[!!] Invalid frame rate %f Hz, keeping %f Hz.\n", frameRate, frameRate_);
+    }
+
+    /**
+     * @brief Statistics of the main loop, to see how much the wait strategy costs.
+    */
+    struct waitStatistics {
+        enumWaitStrategies strategy;            //!< Wait strategy used.
+        unsigned long long loops;               //!< Number of loop iterations.
+        unsigned long long idleLoops;           //!< Number of loop iterations in which nothing was received.
+        double wallTime;                        //!< Time spent in the main loop (in seconds).
+        double cpuTime;                         //!< CPU time consumed by the streaming thread (in seconds).
+        double cpuUsage;                        //!< cpuTime / wallTime (1.0 means a full core).
+    };
+
+    /**
+     * @brief Get the statistics of the main loop (valid after operator() returned).
+    */
+    waitStatistics getWaitStatistics()
+    {
+        return waitStatistics_;
+    }
+
 protected:
 
     /**
@@ -142,6 +297,27 @@ protected:
     */
     int receiveData();
 
+    /**
+     * @brief Log a frame and update the manifest of the session, the sink of the logger.
+    */
+    void logData(const double& timePC, const double& timeQ, const std::vector<double>& data);
+
+    /**
+     * @brief Close the log files and write the index and the manifest of the recorded session.
+    */
+    void finishRecording();
+
+    /**
+     * @brief Timeout used when waiting for QTM to start capturing, depends on the wait strategy.
+     * @return timeout in microseconds.
+    */
+    int waitTimeout();
+
+    /**
+     * @brief Called by the main loop when nothing was received, depends on the wait strategy.
+    */
+    void waitIdle();
+
     /**
      * @brief If user pressed ESC, program halts and finished
     */
@@ -166,15 +342,28 @@ private:
 
     bool record_ = false;                       //!< A flag to record (false).
     std::string recordDirectory_;               //!< Directory for recording data.
+    unsigned int indexInterval_ = 100;          //!< Number of frames between two entries of the session index (100).
+    QualisysSession::sessionManifest manifest_; //!< Manifest of the session being recorded.
 
     enumStreamModes streamMode_ = QualisysConnection::STREAM_USING_MANUAL_BUTTON; //!< Stream mode to decide how the data will be streamed
+    enumWaitStrategies waitStrategy_ = QualisysConnection::WAIT_USING_SPIN; //!< Wait strategy when there is no data
+    double frameRate_ = 100.0;                  //!< Expected frame rate of QTM in Hz (100).
+    const unsigned int spinLimit_ = 1000;       //!< Number of idle loops before yielding, for WAIT_USING_SPIN_THEN_YIELD (1000).
+    unsigned int spinCount_ = 0;                //!< Number of consecutive idle loops.
+    bool idle_ = true;                          //!< A flag which specified if nothing was received in the last loop
+    bool stateAsked_ = false;                   //!< A flag which specified if QTM was asked for its state since the wait started
+    waitStatistics waitStatistics_ = {};        //!< Statistics of the main loop.
     std::string controlPassword_;               //!< A password for controling Qualisys GUI.
 
     double timeStamp_;                          //!< timestamp when a data arrived to PC (in seconds).
 	double timeStampQualisys_;                  //!< timestamp from Qualisys Data Packet converted (in seconds).
     std::vector<std::string> rigidbodyName_;    //!< Contains list of rigidbody names.
     std::vector<double> rigidbodyData_;         //!< Contains value of rigidbodies.
+    std::vector<float> residuals_;              //!< Contains residual of rigidbodies (in mm).
+    QualisysQualityMonitor monitor_;            //!< A class for monitoring the quality of the data
     QualisysLogger* logger_;                    //!< A class for managing logging, inherited from OpenSimFileLogger
+    QualisysFanout fanout_;                     //!< A class for distributing the frames to the logger and other consumers
+    QualisysPoseServer* poseServer_ = nullptr;  //!< A class for re-broadcasting the frames, if started
 
 
     bool userquit_ = false;                     //!< A flag which specified if the user wants to exit
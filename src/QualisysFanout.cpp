@@ -0,0 +1,195 @@
+#include "QualisysFanout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+int QualisysFanout::addSink(const std::string& name, double rate, QualisysFanout::enumDecimationModes mode, sinkFunction function)
+{
+    sink s;
+    s.name = name;
+    s.rate = (rate > 0) ? rate : 0;
+    s.period = (rate > 0) ? 1.0 / rate : 0;
+    s.mode = mode;
+    s.function = function;
+    sinks_.push_back(s);
+
+    return int(sinks_.size()) - 1;
+}
+
+
+void QualisysFanout::push(unsigned int frameNumber, const double& timePC, const double& timeQ, const std::vector<double>& data)
+{
+    // tolerance on the timestamps, so a rate which divides the capture rate is not shifted by one frame because of rounding
+    const double epsilon = 1e-6;
+
+    // the same frame polled twice, every sink already had it
+    if (started_ && frameNumber == lastFrameNumber_)
+        return;
+    started_ = true;
+    lastFrameNumber_ = frameNumber;
+
+    received_++;
+
+    for (std::vector<sink>::iterator it = sinks_.begin(); it != sinks_.end(); it++)
+    {
+        sink& s = *it;
+
+        // full rate sink, nothing to decimate
+        if (s.rate == 0)
+        {
+            s.function(timePC, timeQ, data);
+            s.delivered++;
+            continue;
+        }
+
+        // the sink is due when its period elapsed, or if the Qualisys time jumped back (e.g. QTM restarted the capture)
+        bool due = !s.started || timeQ >= s.nextTime - epsilon || timeQ < s.nextTime - 2 * s.period;
+
+        if (s.mode == QualisysFanout::DECIMATE_USING_LATEST)
+        {
+            if (due)
+            {
+                s.function(timePC, timeQ, data);
+                s.delivered++;
+            }
+        }
+        else
+        {
+            // the average of a period is delivered when the first frame of the next period arrives
+            if (due && s.started)
+            {
+                this->deliverAverage(s);
+            }
+            this->accumulate(s, timePC, timeQ, data);
+        }
+
+        // schedule the next period, keeping the phase so the average rate is exactly the one of the sink
+        if (due)
+        {
+            if (!s.started || timeQ < s.nextTime - 2 * s.period)
+            {
+                s.nextTime = timeQ;
+                s.started = true;
+            }
+            s.nextTime += s.period * (std::floor((timeQ + epsilon - s.nextTime) / s.period) + 1);
+        }
+    }
+}
+
+
+void QualisysFanout::accumulate(sink& s, const double& timePC, const double& timeQ, const std::vector<double>& data)
+{
+    // (re)allocate only if the number of bodies changed, the memory of a sink is fixed otherwise
+    size_t nBodies = data.size() / valuesPerBody;
+    if (s.sum.size() != data.size())
+    {
+        s.sum.assign(data.size(), 0);
+        s.output.assign(data.size(), 0);
+        s.visible.assign(nBodies, 0);
+        s.frames = 0;
+        s.sumTimePC = 0;
+        s.sumTimeQ = 0;
+    }
+
+    s.frames++;
+    s.sumTimePC += timePC;
+    s.sumTimeQ += timeQ;
+
+    for (size_t b = 0; b < nBodies; b++)
+    {
+        const double* value = &data[b * valuesPerBody];
+        double* sum = &s.sum[b * valuesPerBody];
+
+        // a lost body is NaN, it does not take part in the average
+        bool lost = false;
+        for (size_t i = 0; i < valuesPerBody; i++)
+            lost = lost || std::isnan(value[i]);
+        if (lost)
+            continue;
+
+        // q and -q are the same rotation, align the sign with what is already summed before adding
+        double dot = sum[3] * value[3] + sum[4] * value[4] + sum[5] * value[5] + sum[6] * value[6];
+        double sign = (dot < 0) ? -1.0 : 1.0;
+
+        sum[0] += value[0];
+        sum[1] += value[1];
+        sum[2] += value[2];
+        sum[3] += sign * value[3];
+        sum[4] += sign * value[4];
+        sum[5] += sign * value[5];
+        sum[6] += sign * value[6];
+        s.visible[b]++;
+    }
+}
+
+
+void QualisysFanout::deliverAverage(sink& s)
+{
+    if (s.frames == 0)
+        return;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    for (size_t b = 0; b < s.visible.size(); b++)
+    {
+        const double* sum = &s.sum[b * valuesPerBody];
+        double* output = &s.output[b * valuesPerBody];
+
+        // the body was lost during the whole period
+        if (s.visible[b] == 0)
+        {
+            std::fill(output, output + valuesPerBody, nan);
+            continue;
+        }
+
+        output[0] = sum[0] / s.visible[b];
+        output[1] = sum[1] / s.visible[b];
+        output[2] = sum[2] / s.visible[b];
+
+        // the normalized sum of sign-aligned quaternions is a good approximation of the mean rotation
+        // as long as the rotations of the period are close to each other
+        double norm = std::sqrt(sum[3] * sum[3] + sum[4] * sum[4] + sum[5] * sum[5] + sum[6] * sum[6]);
+        for (size_t i = 3; i < valuesPerBody; i++)
+            output[i] = (norm > 0) ? sum[i] / norm : nan;
+    }
+
+    s.function(s.sumTimePC / s.frames, s.sumTimeQ / s.frames, s.output);
+    s.delivered++;
+
+    // reset the sums for the next period
+    std::fill(s.sum.begin(), s.sum.end(), 0);
+    std::fill(s.visible.begin(), s.visible.end(), 0);
+    s.frames = 0;
+    s.sumTimePC = 0;
+    s.sumTimeQ = 0;
+}
+
+
+void QualisysFanout::flush()
+{
+    for (std::vector<sink>::iterator it = sinks_.begin(); it != sinks_.end(); it++)
+    {
+        if (it->rate > 0 && it->mode == QualisysFanout::DECIMATE_USING_AVERAGE)
+            this->deliverAverage(*it);
+
+        // a new streaming starts a new period
+        it->started = false;
+    }
+    started_ = false;
+}
+
+
+void QualisysFanout::report()
+{
+    printf("[OK] Fan-out: %llu frames received.\n", received_);
+    for (std::vector<sink>::const_iterator it = sinks_.begin(); it != sinks_.end(); it++)
+    {
+        if (it->rate == 0)
+            printf("     %s: %llu frames delivered (every frame).\n", it->name.c_str(), it->delivered);
+        else
+            printf("     %s: %llu frames delivered (%.1f Hz, %s).\n", it->name.c_str(), it->delivered, it->rate,
+                (it->mode == QualisysFanout::DECIMATE_USING_LATEST) ? "latest" : "average");
+    }
+}
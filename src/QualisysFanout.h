@@ -0,0 +1,114 @@
+#pragma once
+
+// basic libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+
+/**
+ * @brief A class for distributing the rigid body frames to several sinks, each one at its own rate.
+ *
+ * Every sink declares the rate it needs. A sink with rate 0 receives every frame (e.g. the logger for the archive),
+ * the other sinks receive decimated frames, either the latest sample of every period, or the average of all the
+ * samples of the period (positions averaged, quaternions averaged after sign alignment). Averaging acts as a simple
+ * box low-pass filter, so a slow sink does not see aliasing of the high capture rate.
+ *
+ * The data is expected in the layout of QualisysConnection: tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body,
+ * a lost body being NaN. Sinks are called from the thread calling push(), so they should be quick.
+*/
+class QualisysFanout
+{
+
+
+public:
+
+    enum enumDecimationModes {
+        DECIMATE_USING_LATEST,
+        DECIMATE_USING_AVERAGE
+    };
+
+    static const size_t valuesPerBody = 7;      //!< Values of a rigid body in a frame: tx, ty, tz, Qw, Qx, Qy, Qz.
+
+    /**
+     * @brief Function called with the frames of a sink (PC time, Qualisys time, rigid body values).
+    */
+    typedef std::function<void(const double& timePC, const double& timeQ, const std::vector<double>& data)> sinkFunction;
+
+    /**
+     * @brief Add a sink to the fan-out, not while another thread calls push() (the sinks are not locked).
+     *
+     * @param name Name of the sink, used for reporting.
+     * @param rate Rate needed by the sink in Hz, 0 to receive every frame.
+     * @param mode How the frames are decimated (ignored if rate is 0).
+     * @param function Function receiving the frames.
+     * @return index of the sink.
+    */
+    int addSink(const std::string& name, double rate, QualisysFanout::enumDecimationModes mode, sinkFunction function);
+
+    /**
+     * @brief Push a new frame, delivered to every sink which is due.
+     *
+     * The frames are polled, so the same frame can be pushed several times. A frame with the same frame number as
+     * the previous one is ignored, otherwise it would be delivered twice and weigh more in the averages.
+     *
+     * @param frameNumber Frame number from Qualisys.
+     * @param timePC timestamp when the frame arrived to PC (in seconds).
+     * @param timeQ timestamp from Qualisys (in seconds), used to decide when a sink is due.
+     * @param data tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body.
+    */
+    void push(unsigned int frameNumber, const double& timePC, const double& timeQ, const std::vector<double>& data);
+
+    /**
+     * @brief Deliver the last, partial, period of the averaging sinks, to be called when streaming ends.
+    */
+    void flush();
+
+    /**
+     * @brief Print how many frames every sink received.
+    */
+    void report();
+
+
+private:
+
+    /**
+     * @brief Everything needed to decimate the frames of one sink.
+    */
+    struct sink {
+        std::string name;                       //!< Name of the sink.
+        double rate;                            //!< Rate of the sink in Hz (0 for every frame).
+        double period;                          //!< 1 / rate (in seconds).
+        enumDecimationModes mode;               //!< How the frames are decimated.
+        sinkFunction function;                  //!< Function receiving the frames.
+
+        bool started = false;                   //!< A flag which specified if the first frame was received.
+        double nextTime = 0;                    //!< Qualisys time when the sink is due again (in seconds).
+        unsigned long long delivered = 0;       //!< Number of frames delivered to the sink.
+
+        double sumTimePC = 0;                   //!< Sum of the PC time of the frames of the period (average only).
+        double sumTimeQ = 0;                    //!< Sum of the Qualisys time of the frames of the period (average only).
+        unsigned int frames = 0;                //!< Number of frames in the period (average only).
+        std::vector<double> sum;                //!< Sum of the values of every body (average only).
+        std::vector<unsigned int> visible;      //!< Number of frames in which every body was visible (average only).
+        std::vector<double> output;             //!< Frame delivered to the sink (average only).
+    };
+
+    /**
+     * @brief Add a frame to the sums of a sink.
+    */
+    void accumulate(sink& s, const double& timePC, const double& timeQ, const std::vector<double>& data);
+
+    /**
+     * @brief Deliver the average of the period to a sink and reset its sums.
+    */
+    void deliverAverage(sink& s);
+
+
+    std::vector<sink> sinks_;                   //!< All the sinks.
+    unsigned long long received_ = 0;           //!< Number of frames pushed (without the frames polled twice).
+    bool started_ = false;                      //!< A flag which specified if a frame was already pushed.
+    unsigned int lastFrameNumber_ = 0;          //!< Frame number of the last frame pushed.
+
+};
@@ -34,6 +34,10 @@ void QualisysLogger::log(Logger::LogID logID, const double& timePC, const double
 			break;
 
 		case RigidBody:
+			// remember where every N-th frame starts, so a time range can be read without scanning the file
+			if (_indexInterval > 0 && _cptMarker % _indexInterval == 0)
+				_index.push_back({ _cptMarker, timePC, timeQ, (unsigned long long)file->tellp() });
+
 			_mapLogIDToNumerOfRow[RigidBody]++;
 			*file << _cptMarker << "\t" << std::setprecision(15) << timePC << "\t" << timeQ << "\t";
 
@@ -134,6 +138,15 @@ void QualisysLogger::addLog(Logger::LogID logID, const std::vector<std::string>&
 
 }
 
+void QualisysLogger::finish()
+{
+	for (std::map<Logger::LogID, std::ofstream*>::iterator it = _mapLogIDToFile.begin(); it != _mapLogIDToFile.end(); it++)
+	{
+		it->second->flush();
+		it->second->close();
+	}
+}
+
 void QualisysLogger::markerHearder(std::ofstream& file, const std::vector<std::string>& ColumnName, const unsigned int& numbersOfFrames)
 {
 	file << "DataRate\tCameraRate\tNumFrames\tNumMarkers\tUnits\tOrigDataRate\tOrigDataStartFrame\tOrigNumFrames" << std::endl;
@@ -1,4 +1,6 @@
 #include "OpenSimFileLogger.h"
+// a class for managing the recorded sessions, the logger fills its sparse index
+#include "QualisysSession.h"
 
 
 class QualisysLogger : public OpenSimFileLogger
@@ -15,8 +17,18 @@ public:
 	// overriding header function
 	void markerHearder(std::ofstream& FilePtr, const std::vector<std::string>& ColumnName, const unsigned int& numbersOfFrames);
 
+	// set every how many rigid body frames an entry is added to the index
+	void setIndexInterval(unsigned int interval) { _indexInterval = interval; };
+	// get the sparse index (file offsets) of the rigid body file
+	const std::vector<QualisysSession::indexEntry>& getIndex() { return _index; };
+	// flush and close all the files, to be called when the recording is finished
+	void finish();
+
 	void helloguys();
 
 private:
 
+	unsigned int _indexInterval = 100;
+	std::vector<QualisysSession::indexEntry> _index;
+
 };
\ No newline at end of file
@@ -0,0 +1,164 @@
+// boost asio has to be included before anything including windows.h (winsock2 issue)
+#include <boost/asio.hpp>
+
+#include "QualisysPoseClient.h"
+
+
+struct QualisysPoseClient::network
+{
+    boost::asio::io_context io;
+    std::unique_ptr<boost::asio::ip::udp::socket> udpSocket;
+    std::unique_ptr<boost::asio::ip::tcp::socket> tcpSocket;
+};
+
+
+QualisysPoseClient::QualisysPoseClient() : network_(new network())
+{
+}
+
+QualisysPoseClient::~QualisysPoseClient()
+{
+    this->close();
+}
+
+
+int QualisysPoseClient::connectUDP(const std::string& multicastAddress, unsigned short port)
+{
+    this->close();
+
+    boost::system::error_code ec;
+    boost::asio::ip::address address = boost::asio::ip::make_address(multicastAddress, ec);
+    if (ec || !address.is_multicast())
+    {
+        printf("[!!] Pose client: %s is not a multicast address.\n", multicastAddress.c_str());
+        return -1;
+    }
+
+    // listen to the port on every interface, several clients can run on the same machine
+    boost::asio::ip::udp::endpoint endpoint(address.is_v4() ? boost::asio::ip::address(boost::asio::ip::address_v4::any())
+                                                             : boost::asio::ip::address(boost::asio::ip::address_v6::any()), port);
+    network_->udpSocket.reset(new boost::asio::ip::udp::socket(network_->io));
+    network_->udpSocket->open(endpoint.protocol(), ec);
+    if (!ec) network_->udpSocket->set_option(boost::asio::ip::udp::socket::reuse_address(true), ec);
+    if (!ec) network_->udpSocket->bind(endpoint, ec);
+    if (!ec) network_->udpSocket->set_option(boost::asio::ip::multicast::join_group(address), ec);
+    if (ec)
+    {
+        printf("[!!] Pose client: cannot join %s:%d (%s).\n", multicastAddress.c_str(), port, ec.message().c_str());
+        network_->udpSocket.reset();
+        return -1;
+    }
+
+    printf("[OK] Pose client: joined UDP multicast %s:%d\n", multicastAddress.c_str(), port);
+    return 0;
+}
+
+
+int QualisysPoseClient::connectTCP(const std::string& host, unsigned short port)
+{
+    this->close();
+
+    boost::system::error_code ec;
+    boost::asio::ip::tcp::resolver resolver(network_->io);
+    boost::asio::ip::tcp::resolver::results_type endpoints = resolver.resolve(host, std::to_string(port), ec);
+
+    network_->tcpSocket.reset(new boost::asio::ip::tcp::socket(network_->io));
+    if (!ec) boost::asio::connect(*network_->tcpSocket, endpoints, ec);
+    if (!ec) network_->tcpSocket->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    if (ec)
+    {
+        printf("[!!] Pose client: cannot connect to %s:%d (%s).\n", host.c_str(), port, ec.message().c_str());
+        network_->tcpSocket.reset();
+        return -1;
+    }
+
+    printf("[OK] Pose client: connected to %s:%d\n", host.c_str(), port);
+    return 0;
+}
+
+
+int QualisysPoseClient::receive(QualisysPoseClient::poseFrame& frame)
+{
+    QualisysPosePacket::packetHeader header;
+    boost::system::error_code ec;
+
+    while (true)
+    {
+        size_t size = 0;
+
+        if (network_->udpSocket)
+        {
+            // one datagram is one packet
+            buffer_.resize(65536);
+            size = network_->udpSocket->receive(boost::asio::buffer(buffer_), 0, ec);
+        }
+        else if (network_->tcpSocket)
+        {
+            // a stream, read the fixed part first to know the size of the packet (decodeHeader() rejects a size above
+            // QualisysPosePacket::maxSize, so a corrupt stream cannot make us allocate gigabytes)
+            buffer_.resize(QualisysPosePacket::headerSize);
+            boost::asio::read(*network_->tcpSocket, boost::asio::buffer(buffer_), ec);
+            if (!ec && QualisysPosePacket::decodeHeader(buffer_.data(), buffer_.size(), header) != 0)
+            {
+                printf("[!!] Pose client: invalid packet received, connection closed.\n");
+                this->close();
+                return -1;
+            }
+            if (!ec)
+            {
+                buffer_.resize(header.size);
+                boost::asio::read(*network_->tcpSocket,
+                    boost::asio::buffer(buffer_.data() + QualisysPosePacket::headerSize, header.size - QualisysPosePacket::headerSize), ec);
+            }
+            size = buffer_.size();
+        }
+        else
+        {
+            return -1;
+        }
+
+        if (ec)
+        {
+            printf("[!!] Pose client: connection closed (%s).\n", ec.message().c_str());
+            this->close();
+            return -1;
+        }
+
+        // anything which is not a packet of the server is ignored
+        if (QualisysPosePacket::decodeHeader(buffer_.data(), size, header) != 0)
+            continue;
+
+        if (header.type == QualisysPosePacket::PACKET_DESCRIPTION)
+        {
+            QualisysPosePacket::decodeDescription(buffer_.data(), size, header, bodies_);
+            continue;
+        }
+
+        if (QualisysPosePacket::decodeFrame(buffer_.data(), size, header, frame.data) != 0)
+            continue;
+
+        // count the gaps in the sequence numbers (a sequence going back means the server was restarted)
+        uint32_t gap = header.sequence - lastSequence_;
+        if (started_ && gap > 1 && gap < 0x80000000u)
+            lostFrames_ += gap - 1;
+        started_ = true;
+        lastSequence_ = header.sequence;
+
+        frame.sequence = header.sequence;
+        frame.timePC = header.timePC;
+        frame.timeQ = header.timeQ;
+        return 0;
+    }
+}
+
+
+void QualisysPoseClient::close()
+{
+    boost::system::error_code ignored;
+    if (network_->udpSocket)
+        network_->udpSocket->close(ignored);
+    if (network_->tcpSocket)
+        network_->tcpSocket->close(ignored);
+    network_->udpSocket.reset();
+    network_->tcpSocket.reset();
+}
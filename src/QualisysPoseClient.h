@@ -0,0 +1,95 @@
+#pragma once
+
+// basic libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+// the packet sent by the server
+#include "QualisysPosePacket.h"
+
+
+/**
+ * @brief A class for receiving the rigid body frames re-broadcast by QualisysPoseServer.
+ *
+ * Connect either to the UDP multicast group or to the TCP port of the server, then call receive() in a loop.
+ * The names of the rigid bodies are taken from the description packets sent by the server.
+*/
+class QualisysPoseClient
+{
+
+
+public:
+
+    /**
+     * @brief One frame received from the server.
+    */
+    struct poseFrame {
+        uint32_t sequence;                      //!< Sequence number of the frame.
+        double timePC;                          //!< timestamp when the frame arrived to the PC of QTM connection (in seconds).
+        double timeQ;                           //!< timestamp from Qualisys (in seconds).
+        std::vector<double> data;               //!< tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body.
+    };
+
+    QualisysPoseClient();
+    ~QualisysPoseClient();
+
+    /**
+     * @brief Join the UDP multicast group of the server.
+     *
+     * @param multicastAddress Multicast group, e.g. 239.255.42.99.
+     * @param port UDP port of the group.
+     * @return 0 success, -1 error occured.
+    */
+    int connectUDP(const std::string& multicastAddress, unsigned short port);
+
+    /**
+     * @brief Connect to the TCP port of the server.
+     *
+     * @param host Name or IP address of the machine running the server.
+     * @param port TCP port of the server.
+     * @return 0 success, -1 error occured.
+    */
+    int connectTCP(const std::string& host, unsigned short port);
+
+    /**
+     * @brief Wait for the next frame (blocking).
+     * @return 0 success, -1 error occured or connection closed.
+    */
+    int receive(QualisysPoseClient::poseFrame& frame);
+
+    /**
+     * @brief Close the connection.
+    */
+    void close();
+
+    /**
+     * @brief Get the names of the rigid bodies, in the order of the data (empty until a description was received).
+    */
+    std::vector<std::string> getBodies()
+    {
+        return bodies_;
+    }
+
+    /**
+     * @brief Get the number of frames lost, from the gaps in the sequence numbers.
+    */
+    unsigned long long getLostFrames()
+    {
+        return lostFrames_;
+    }
+
+
+private:
+
+    struct network;                             //!< Sockets of the client (boost asio, kept out of this header).
+
+    std::unique_ptr<network> network_;          //!< Sockets of the client.
+    std::vector<uint8_t> buffer_;               //!< Last packet received.
+    std::vector<std::string> bodies_;           //!< Names of the rigid bodies.
+    bool started_ = false;                      //!< A flag which specified if a frame was already received.
+    uint32_t lastSequence_ = 0;                 //!< Sequence number of the last frame.
+    unsigned long long lostFrames_ = 0;         //!< Number of frames lost.
+
+};
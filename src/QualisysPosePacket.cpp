@@ -0,0 +1,180 @@
+#include "QualisysPosePacket.h"
+
+#include <cstring>
+
+
+// the values are written byte by byte, so the layout does not depend on the endianness of the machine
+static void writeU16(uint8_t* p, uint16_t v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+}
+
+static void writeU32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = uint8_t(v >> (8 * i));
+}
+
+static void writeU64(uint8_t* p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = uint8_t(v >> (8 * i));
+}
+
+static void writeFloat(uint8_t* p, float v)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    writeU32(p, bits);
+}
+
+static void writeDouble(uint8_t* p, double v)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    writeU64(p, bits);
+}
+
+static uint16_t readU16(const uint8_t* p)
+{
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= uint32_t(p[i]) << (8 * i);
+    return v;
+}
+
+static uint64_t readU64(const uint8_t* p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= uint64_t(p[i]) << (8 * i);
+    return v;
+}
+
+static float readFloat(const uint8_t* p)
+{
+    uint32_t bits = readU32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static double readDouble(const uint8_t* p)
+{
+    uint64_t bits = readU64(p);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void writeHeader(uint8_t* p, QualisysPosePacket::enumPacketTypes type, uint16_t bodyCount, uint32_t size,
+    uint32_t sequence, double timePC, double timeQ)
+{
+    writeU32(p, QualisysPosePacket::magic);
+    p[4] = QualisysPosePacket::version;
+    p[5] = uint8_t(type);
+    writeU16(p + 6, bodyCount);
+    writeU32(p + 8, size);
+    writeU32(p + 12, sequence);
+    writeDouble(p + 16, timePC);
+    writeDouble(p + 24, timeQ);
+}
+
+
+void QualisysPosePacket::encodeFrame(std::vector<uint8_t>& buffer, uint32_t sequence, double timePC, double timeQ, const std::vector<double>& data)
+{
+    uint16_t bodyCount = uint16_t(data.size() / QualisysFanout::valuesPerBody);
+    size_t size = headerSize + bodyCount * QualisysFanout::valuesPerBody * sizeof(float);
+    buffer.resize(size);
+
+    writeHeader(buffer.data(), PACKET_FRAME, bodyCount, uint32_t(size), sequence, timePC, timeQ);
+
+    uint8_t* p = buffer.data() + headerSize;
+    for (size_t i = 0; i < bodyCount * QualisysFanout::valuesPerBody; i++, p += sizeof(float))
+        writeFloat(p, float(data[i]));
+}
+
+
+void QualisysPosePacket::encodeDescription(std::vector<uint8_t>& buffer, uint32_t sequence, const std::vector<std::string>& bodies)
+{
+    size_t size = headerSize;
+    for (std::vector<std::string>::const_iterator it = bodies.begin(); it != bodies.end(); it++)
+        size += it->size() + 1;
+    buffer.resize(size);
+
+    writeHeader(buffer.data(), PACKET_DESCRIPTION, uint16_t(bodies.size()), uint32_t(size), sequence, 0, 0);
+
+    uint8_t* p = buffer.data() + headerSize;
+    for (std::vector<std::string>::const_iterator it = bodies.begin(); it != bodies.end(); it++)
+    {
+        std::memcpy(p, it->c_str(), it->size() + 1);
+        p += it->size() + 1;
+    }
+}
+
+
+int QualisysPosePacket::decodeHeader(const uint8_t* buffer, size_t size, packetHeader& header)
+{
+    if (size < headerSize || readU32(buffer) != magic || buffer[4] != version)
+        return -1;
+
+    header.type = enumPacketTypes(buffer[5]);
+    header.bodyCount = readU16(buffer + 6);
+    header.size = readU32(buffer + 8);
+    header.sequence = readU32(buffer + 12);
+    header.timePC = readDouble(buffer + 16);
+    header.timeQ = readDouble(buffer + 24);
+
+    // the size comes from the wire, never trust it to allocate more than a valid packet can be
+    if (header.size < headerSize || header.size > maxSize || (header.type != PACKET_FRAME && header.type != PACKET_DESCRIPTION))
+        return -1;
+
+    return 0;
+}
+
+
+int QualisysPosePacket::decodeFrame(const uint8_t* buffer, size_t size, packetHeader& header, std::vector<double>& data)
+{
+    if (decodeHeader(buffer, size, header) != 0 || header.type != PACKET_FRAME)
+        return -1;
+
+    size_t values = size_t(header.bodyCount) * QualisysFanout::valuesPerBody;
+    if (header.size != headerSize + values * sizeof(float) || size < header.size)
+        return -1;
+
+    data.resize(values);
+    const uint8_t* p = buffer + headerSize;
+    for (size_t i = 0; i < values; i++, p += sizeof(float))
+        data[i] = readFloat(p);
+
+    return 0;
+}
+
+
+int QualisysPosePacket::decodeDescription(const uint8_t* buffer, size_t size, packetHeader& header, std::vector<std::string>& bodies)
+{
+    if (decodeHeader(buffer, size, header) != 0 || header.type != PACKET_DESCRIPTION || size < header.size)
+        return -1;
+
+    bodies.clear();
+    const char* p = (const char*)buffer + headerSize;
+    const char* end = (const char*)buffer + header.size;
+    while (p < end && bodies.size() < header.bodyCount)
+    {
+        const char* name = p;
+        while (p < end && *p != '\0')
+            p++;
+        if (p == end)
+            return -1;
+        bodies.push_back(std::string(name, p));
+        p++;
+    }
+
+    return (bodies.size() == header.bodyCount) ? 0 : -1;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// basic libraries
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the layout of the frames
+#include "QualisysFanout.h"
+
+
+/**
+ * @brief Binary packet used to re-broadcast the rigid body frames over the network.
+ *
+ * All the values are little-endian, the layout is fixed:
+ *
+ *   offset  size  content
+ *   0       4     magic 'QPOS'
+ *   4       1     version (1)
+ *   5       1     type (PACKET_FRAME or PACKET_DESCRIPTION)
+ *   6       2     number of rigid bodies
+ *   8       4     size of the whole packet (in bytes)
+ *   12      4     sequence number of the frame
+ *   16      8     timestamp when the frame arrived to the PC of QTM connection (double, in seconds)
+ *   24      8     timestamp from Qualisys (double, in seconds)
+ *   32      ...   PACKET_FRAME: tx, ty, tz, Qw, Qx, Qy, Qz of every rigid body (float, 28 bytes per body)
+ *                 PACKET_DESCRIPTION: name of every rigid body ('\0' terminated)
+ *
+ * The description is sent to every TCP client when it connects, and regularly over UDP, so a client
+ * knows which rigid body is where in the frames.
+*/
+class QualisysPosePacket
+{
+
+
+public:
+
+    enum enumPacketTypes {
+        PACKET_FRAME = 1,
+        PACKET_DESCRIPTION = 2
+    };
+
+    /**
+     * @brief Content of the fixed part of a packet.
+    */
+    struct packetHeader {
+        enumPacketTypes type;                   //!< Type of the packet.
+        uint16_t bodyCount;                     //!< Number of rigid bodies.
+        uint32_t size;                          //!< Size of the whole packet (in bytes).
+        uint32_t sequence;                      //!< Sequence number of the frame.
+        double timePC;                          //!< timestamp when the frame arrived to PC (in seconds).
+        double timeQ;                           //!< timestamp from Qualisys (in seconds).
+    };
+
+    static const uint32_t magic = 0x534F5051;   //!< 'QPOS' read as little-endian.
+    static const uint8_t version = 1;           //!< Version of the layout.
+    static const size_t headerSize = 32;        //!< Size of the fixed part of a packet (in bytes).
+    static const size_t maxSize = headerSize + 65535 * QualisysFanout::valuesPerBody * sizeof(float); //!< Largest valid packet (in bytes).
+
+    /**
+     * @brief Encode a frame.
+     * @param data tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body.
+    */
+    static void encodeFrame(std::vector<uint8_t>& buffer, uint32_t sequence, double timePC, double timeQ, const std::vector<double>& data);
+
+    /**
+     * @brief Encode the list of the rigid body names.
+    */
+    static void encodeDescription(std::vector<uint8_t>& buffer, uint32_t sequence, const std::vector<std::string>& bodies);
+
+    /**
+     * @brief Decode the fixed part of a packet.
+     * @return 0 success, -1 not a valid packet (including a size above maxSize).
+    */
+    static int decodeHeader(const uint8_t* buffer, size_t size, packetHeader& header);
+
+    /**
+     * @brief Decode a PACKET_FRAME.
+     * @return 0 success, -1 not a valid frame.
+    */
+    static int decodeFrame(const uint8_t* buffer, size_t size, packetHeader& header, std::vector<double>& data);
+
+    /**
+     * @brief Decode a PACKET_DESCRIPTION.
+     * @return 0 success, -1 not a valid description.
+    */
+    static int decodeDescription(const uint8_t* buffer, size_t size, packetHeader& header, std::vector<std::string>& bodies);
+
+};
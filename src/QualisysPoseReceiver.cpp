@@ -0,0 +1,59 @@
+// QualisysPoseReceiver.cpp : Example client printing the frames re-broadcast by QualisysPoseServer.
+//
+// Examples:
+//   QualisysPoseReceiver --udp 239.255.42.99 --port 45454
+//   QualisysPoseReceiver --tcp 192.168.1.10 --port 45455
+//
+
+#include <iostream>
+#include <iomanip>
+#include "QualisysPoseClient.h"
+
+// dependencies
+#include <tclap/CmdLine.h>
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		TCLAP::CmdLine cmd("Print the rigid body frames re-broadcast by a QualisysConnection.", ' ', "1.0");
+		TCLAP::ValueArg<std::string> argUDP("u", "udp", "Multicast group to join.", false, "239.255.42.99", "address", cmd);
+		TCLAP::ValueArg<std::string> argTCP("t", "tcp", "Host to connect to with TCP (instead of UDP).", false, "", "host", cmd);
+		TCLAP::ValueArg<unsigned short> argPort("p", "port", "UDP or TCP port of the server.", false, 45454, "port", cmd);
+		TCLAP::ValueArg<int> argCount("n", "count", "Number of frames to receive (0 for no limit).", false, 0, "frames", cmd);
+		cmd.parse(argc, argv);
+
+		QualisysPoseClient client;
+		int status = argTCP.getValue().empty() ? client.connectUDP(argUDP.getValue(), argPort.getValue())
+		                                       : client.connectTCP(argTCP.getValue(), argPort.getValue());
+		if (status != 0)
+			return -1;
+
+		QualisysPoseClient::poseFrame frame;
+		std::cout << std::setprecision(15);
+		for (int i = 0; argCount.getValue() == 0 || i < argCount.getValue(); i++)
+		{
+			if (client.receive(frame) != 0)
+				break;
+
+			std::cout << frame.sequence << "\t" << frame.timePC << "\t" << frame.timeQ;
+			for (std::vector<double>::const_iterator it = frame.data.begin(); it != frame.data.end(); it++)
+				std::cout << "\t" << *it;
+			std::cout << std::endl;
+		}
+
+		std::cout << "[OK] Bodies:";
+		std::vector<std::string> bodies = client.getBodies();
+		for (std::vector<std::string>::const_iterator it = bodies.begin(); it != bodies.end(); it++)
+			std::cout << " " << *it;
+		std::cout << ", frames lost: " << client.getLostFrames() << std::endl;
+	}
+	catch (TCLAP::ArgException& e)
+	{
+		std::cerr << "[!!] " << e.error() << " for arg " << e.argId() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+// boost asio has to be included before anything including windows.h (winsock2 issue)
+#include <boost/asio.hpp>
+
+#include "QualisysPoseServer.h"
+
+#include <deque>
+#include <set>
+
+
+typedef std::shared_ptr<std::vector<uint8_t> > packetPtr;
+
+/**
+ * @brief A TCP client and the packets waiting to be written to it.
+*/
+struct tcpClient
+{
+    tcpClient(boost::asio::ip::tcp::socket s) : socket(std::move(s)) {}
+
+    boost::asio::ip::tcp::socket socket;
+    std::deque<packetPtr> queue;
+};
+
+typedef std::shared_ptr<tcpClient> tcpClientPtr;
+
+
+struct QualisysPoseServer::network
+{
+    network() : work(boost::asio::make_work_guard(io)) {}
+
+    boost::asio::io_context io;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+
+    std::unique_ptr<boost::asio::ip::udp::socket> udpSocket;
+    boost::asio::ip::udp::endpoint udpEndpoint;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
+    std::set<tcpClientPtr> clients;
+
+    unsigned long long sentUDP = 0;
+    unsigned long long acceptedClients = 0;
+    unsigned long long droppedClients = 0;
+
+    // everything below is only called from the thread of the server
+
+    void accept(QualisysPoseServer* server)
+    {
+        acceptor->async_accept([this, server](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
+        {
+            if (!ec)
+            {
+                boost::system::error_code ignored;
+                socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                tcpClientPtr client = std::make_shared<tcpClient>(std::move(socket));
+                clients.insert(client);
+                acceptedClients++;
+
+                // a new client first needs to know which rigid body is where
+                packetPtr description;
+                {
+                    std::lock_guard<std::mutex> lock(server->mtxBodies_);
+                    description = std::make_shared<std::vector<uint8_t> >(server->description_);
+                }
+                if (!description->empty())
+                    this->queue(client, description, server->maxQueue_);
+            }
+
+            if (acceptor && acceptor->is_open())
+                this->accept(server);
+        });
+    }
+
+    void send(const packetPtr& packet, bool udp, bool tcp, size_t maxQueue)
+    {
+        if (udp && udpSocket)
+        {
+            // a lost udp packet is not an error, the clients will see the gap in the sequence number
+            boost::system::error_code ignored;
+            udpSocket->send_to(boost::asio::buffer(*packet), udpEndpoint, 0, ignored);
+            sentUDP++;
+        }
+
+        if (tcp)
+        {
+            // copy, queue() can remove a client from the set
+            std::vector<tcpClientPtr> all(clients.begin(), clients.end());
+            for (std::vector<tcpClientPtr>::iterator it = all.begin(); it != all.end(); it++)
+                this->queue(*it, packet, maxQueue);
+        }
+    }
+
+    void queue(const tcpClientPtr& client, const packetPtr& packet, size_t maxQueue)
+    {
+        // the client does not read fast enough, rather disconnect it than slow down everybody
+        if (client->queue.size() >= maxQueue)
+        {
+            printf("[!!] Pose server: TCP client too slow, disconnected.\n");
+            this->drop(client);
+            return;
+        }
+
+        bool writing = !client->queue.empty();
+        client->queue.push_back(packet);
+        if (!writing)
+            this->write(client);
+    }
+
+    void write(const tcpClientPtr& client)
+    {
+        // the handler keeps the packet alive, drop() clears the queue while the write can still be pending
+        packetPtr packet = client->queue.front();
+        boost::asio::async_write(client->socket, boost::asio::buffer(*packet),
+            [this, client, packet](const boost::system::error_code& ec, std::size_t)
+        {
+            if (ec)
+            {
+                this->drop(client);
+                return;
+            }
+
+            // the client was dropped after this write completed, its queue is already empty
+            if (clients.count(client) == 0)
+                return;
+
+            client->queue.pop_front();
+            if (!client->queue.empty())
+                this->write(client);
+        });
+    }
+
+    void drop(const tcpClientPtr& client)
+    {
+        if (clients.erase(client) == 0)
+            return;
+
+        boost::system::error_code ignored;
+        client->socket.close(ignored);
+        client->queue.clear();
+        droppedClients++;
+    }
+
+    void close()
+    {
+        boost::system::error_code ignored;
+        if (acceptor)
+            acceptor->close(ignored);
+        if (udpSocket)
+            udpSocket->close(ignored);
+        for (std::set<tcpClientPtr>::iterator it = clients.begin(); it != clients.end(); it++)
+            (*it)->socket.close(ignored);
+        clients.clear();
+    }
+};
+
+
+QualisysPoseServer::QualisysPoseServer() : network_(new network())
+{
+}
+
+QualisysPoseServer::~QualisysPoseServer()
+{
+    this->stop();
+}
+
+
+int QualisysPoseServer::startUDP(const std::string& multicastAddress, unsigned short port, int ttl)
+{
+    boost::system::error_code ec;
+    boost::asio::ip::address address = boost::asio::ip::make_address(multicastAddress, ec);
+    if (ec || !address.is_multicast())
+    {
+        printf("[!!] Pose server: %s is not a multicast address.\n", multicastAddress.c_str());
+        return -1;
+    }
+
+    network_->udpEndpoint = boost::asio::ip::udp::endpoint(address, port);
+    network_->udpSocket.reset(new boost::asio::ip::udp::socket(network_->io));
+    network_->udpSocket->open(network_->udpEndpoint.protocol(), ec);
+    if (!ec) network_->udpSocket->set_option(boost::asio::ip::multicast::hops(ttl), ec);
+    if (!ec) network_->udpSocket->set_option(boost::asio::ip::multicast::enable_loopback(true), ec);
+    if (ec)
+    {
+        printf("[!!] Pose server: cannot open UDP socket (%s).\n", ec.message().c_str());
+        network_->udpSocket.reset();
+        return -1;
+    }
+
+    this->startThread();
+    printf("[OK] Pose server: sending frames to UDP multicast %s:%d\n", multicastAddress.c_str(), port);
+    return 0;
+}
+
+
+int QualisysPoseServer::startTCP(unsigned short port)
+{
+    boost::system::error_code ec;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+
+    network_->acceptor.reset(new boost::asio::ip::tcp::acceptor(network_->io));
+    network_->acceptor->open(endpoint.protocol(), ec);
+    if (!ec) network_->acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), ec);
+    if (!ec) network_->acceptor->bind(endpoint, ec);
+    if (!ec) network_->acceptor->listen(boost::asio::socket_base::max_listen_connections, ec);
+    if (ec)
+    {
+        printf("[!!] Pose server: cannot listen to TCP port %d (%s).\n", port, ec.message().c_str());
+        network_->acceptor.reset();
+        return -1;
+    }
+
+    // start accepting from the thread of the server
+    network* net = network_.get();
+    boost::asio::post(net->io, [net, this]() { net->accept(this); });
+
+    this->startThread();
+    printf("[OK] Pose server: accepting TCP clients on port %d\n", port);
+    return 0;
+}
+
+
+void QualisysPoseServer::startThread()
+{
+    if (thread_)
+        return;
+
+    network* net = network_.get();
+    thread_ = new std::thread([net]() { net->io.run(); });
+}
+
+
+void QualisysPoseServer::stop()
+{
+    if (!thread_)
+        return;
+
+    // close everything from the thread of the server, then let it finish
+    network* net = network_.get();
+    boost::asio::post(net->io, [net]() { net->close(); });
+    net->work.reset();
+    thread_->join();
+    delete thread_;
+    thread_ = nullptr;
+
+    // keep the statistics, then be ready to be started again
+    sentUDP_ += net->sentUDP;
+    acceptedClients_ += net->acceptedClients;
+    droppedClients_ += net->droppedClients;
+    network_.reset(new network());
+}
+
+
+void QualisysPoseServer::setBodies(const std::vector<std::string>& bodies)
+{
+    packetPtr description = std::make_shared<std::vector<uint8_t> >();
+    {
+        std::lock_guard<std::mutex> lock(mtxBodies_);
+        bodies_ = bodies;
+        QualisysPosePacket::encodeDescription(description_, sequence_, bodies_);
+        *description = description_;
+    }
+
+    // the clients already connected need the new description too
+    if (thread_)
+    {
+        network* net = network_.get();
+        size_t maxQueue = maxQueue_;
+        boost::asio::post(net->io, [net, description, maxQueue]() { net->send(description, true, true, maxQueue); });
+    }
+}
+
+
+void QualisysPoseServer::publish(const double& timePC, const double& timeQ, const std::vector<double>& data)
+{
+    // nothing started, nobody to send to
+    if (!thread_)
+        return;
+
+    packetPtr packet = std::make_shared<std::vector<uint8_t> >();
+    QualisysPosePacket::encodeFrame(*packet, sequence_++, timePC, timeQ, data);
+
+    // udp clients can join at any time, so they get the description regularly
+    packetPtr description;
+    if (timePC - lastDescription_ >= descriptionPeriod_ || timePC < lastDescription_)
+    {
+        std::lock_guard<std::mutex> lock(mtxBodies_);
+        description = std::make_shared<std::vector<uint8_t> >(description_);
+        lastDescription_ = timePC;
+    }
+
+    network* net = network_.get();
+    size_t maxQueue = maxQueue_;
+    boost::asio::post(net->io, [net, packet, description, maxQueue]()
+    {
+        if (description && !description->empty())
+            net->send(description, true, false, maxQueue);
+        net->send(packet, true, true, maxQueue);
+    });
+}
+
+
+void QualisysPoseServer::report()
+{
+    printf("[OK] Pose server: %u frames published, %llu UDP packets sent, %llu TCP clients accepted (%llu disconnected).\n",
+        sequence_, sentUDP_ + network_->sentUDP, acceptedClients_ + network_->acceptedClients, droppedClients_ + network_->droppedClients);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// basic libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// the packet sent to the clients
+#include "QualisysPosePacket.h"
+
+
+/**
+ * @brief A class for re-broadcasting the rigid body frames to other machines.
+ *
+ * The frames are sent as QualisysPosePacket over UDP multicast (cheap, for any number of clients, packets can be
+ * lost) and/or over TCP (reliable, one connection per client). The network is handled by a thread of the server,
+ * so publish() only encodes the packet and returns. A TCP client which does not read fast enough is disconnected
+ * instead of slowing down the streaming.
+*/
+class QualisysPoseServer
+{
+
+
+public:
+
+    QualisysPoseServer();
+    ~QualisysPoseServer();
+
+    /**
+     * @brief Start sending the frames to a UDP multicast group.
+     *
+     * @param multicastAddress Multicast group, e.g. 239.255.42.99.
+     * @param port UDP port of the group.
+     * @param ttl Number of routers the packets can cross (1 stays in the local network).
+     * @return 0 success, -1 error occured.
+    */
+    int startUDP(const std::string& multicastAddress, unsigned short port, int ttl = 1);
+
+    /**
+     * @brief Start accepting TCP clients.
+     *
+     * @param port TCP port to listen to.
+     * @return 0 success, -1 error occured.
+    */
+    int startTCP(unsigned short port);
+
+    /**
+     * @brief Stop sending and disconnect all the clients.
+    */
+    void stop();
+
+    /**
+     * @brief Set the names of the rigid bodies, sent to the clients in the description packet.
+    */
+    void setBodies(const std::vector<std::string>& bodies);
+
+    /**
+     * @brief Send a frame to all the clients.
+     *
+     * @param timePC timestamp when the frame arrived to PC (in seconds).
+     * @param timeQ timestamp from Qualisys (in seconds).
+     * @param data tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body.
+    */
+    void publish(const double& timePC, const double& timeQ, const std::vector<double>& data);
+
+    /**
+     * @brief Print how many frames were sent and to how many clients (exact once stopped).
+    */
+    void report();
+
+
+private:
+
+    struct network;                             //!< Sockets of the server (boost asio, kept out of this header).
+
+    /**
+     * @brief Start the thread running the network, if not already running.
+    */
+    void startThread();
+
+    std::unique_ptr<network> network_;          //!< Sockets of the server.
+    std::thread* thread_ = nullptr;             //!< Thread running the network.
+
+    std::mutex mtxBodies_;                      //!< Protects bodies_ and description_.
+    std::vector<std::string> bodies_;           //!< Names of the rigid bodies.
+    std::vector<uint8_t> description_;          //!< Encoded description packet.
+
+    uint32_t sequence_ = 0;                     //!< Sequence number of the next frame.
+    double lastDescription_ = 0;                //!< PC time when the description was last sent over UDP (in seconds).
+    const double descriptionPeriod_ = 1.0;      //!< Period of the description over UDP (in seconds).
+    unsigned long long sentUDP_ = 0;            //!< Number of UDP packets sent before the last stop().
+    unsigned long long acceptedClients_ = 0;    //!< Number of TCP clients accepted before the last stop().
+    unsigned long long droppedClients_ = 0;     //!< Number of TCP clients disconnected before the last stop().
+    const size_t maxQueue_ = 1000;              //!< Number of packets waiting for a TCP client before it is disconnected.
+
+};
@@ -0,0 +1,197 @@
+#include "QualisysQualityMonitor.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+QualisysQualityMonitor::QualisysQualityMonitor()
+{
+    // by default, just print the alerts
+    alertFunction_ = [](QualisysQualityMonitor::enumAlerts alert, const std::string& body, double value)
+    {
+        switch (alert)
+        {
+            case QualisysQualityMonitor::ALERT_VISIBILITY:
+                printf("[!!] Quality: %s visible in only %.0f%% of the recent frames.\n", body.c_str(), 100 * value);
+                break;
+            case QualisysQualityMonitor::ALERT_GAP:
+                printf("[!!] Quality: %s lost for %.0f frames.\n", body.c_str(), value);
+                break;
+            case QualisysQualityMonitor::ALERT_RESIDUAL:
+                printf("[!!] Quality: %s residual %.2f mm.\n", body.c_str(), value);
+                break;
+            case QualisysQualityMonitor::ALERT_SKIPPED_FRAMES:
+                printf("[!!] Quality: %.0f frames skipped.\n", value);
+                break;
+        }
+    };
+}
+
+
+void QualisysQualityMonitor::setBodies(const std::vector<std::string>& bodies)
+{
+    std::lock_guard<std::mutex> lock(mtxStatistics_);
+
+    // all the memory is allocated here, update() does not allocate
+    statistics_ = qualityStatistics();
+    statistics_.bodies.resize(bodies.size());
+    for (size_t b = 0; b < bodies.size(); b++)
+        statistics_.bodies[b].name = bodies[b];
+
+    residualSum_.assign(bodies.size(), 0);
+    residualCount_.assign(bodies.size(), 0);
+    alerted_.assign(bodies.size() * alertsPerBody_, false);
+    pendingAlerts_.clear();
+    pendingAlerts_.reserve(bodies.size() * alertsPerBody_ + 1);
+    started_ = false;
+}
+
+
+void QualisysQualityMonitor::setThresholds(double minVisibility, unsigned long long maxGap, double maxResidual, unsigned long long maxSkippedFrames)
+{
+    std::lock_guard<std::mutex> lock(mtxStatistics_);
+
+    minVisibility_ = minVisibility;
+    maxGap_ = maxGap;
+    maxResidual_ = maxResidual;
+    maxSkippedFrames_ = maxSkippedFrames;
+}
+
+
+void QualisysQualityMonitor::update(unsigned int frameNumber, const std::vector<double>& data, const std::vector<float>& residuals)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtxStatistics_);
+        pendingAlerts_.clear();
+        this->updateStatistics(frameNumber, data, residuals);
+    }
+
+    // the alert function is called without the lock, so it can read the statistics.
+    // the names of the bodies only change in setBodies(), called by this same thread
+    static const std::string noName;
+    if (alertFunction_)
+    {
+        for (std::vector<pendingAlert>::const_iterator it = pendingAlerts_.begin(); it != pendingAlerts_.end(); it++)
+            alertFunction_(it->alert, (it->body == noBody_) ? noName : statistics_.bodies[it->body].name, it->value);
+    }
+}
+
+
+void QualisysQualityMonitor::updateStatistics(unsigned int frameNumber, const std::vector<double>& data, const std::vector<float>& residuals)
+{
+    // frames missing between the previous frame and this one (a frame number going back means a new capture).
+    // frames are polled, so a frame number which jumps usually means the frames were not polled in time
+    if (started_)
+    {
+        if (frameNumber == lastFrameNumber_)
+            return;
+
+        if (frameNumber > lastFrameNumber_ + 1)
+        {
+            unsigned long long skipped = frameNumber - lastFrameNumber_ - 1;
+            statistics_.skippedFrames += skipped;
+            if (maxSkippedFrames_ > 0 && skipped >= maxSkippedFrames_)
+                this->alert(QualisysQualityMonitor::ALERT_SKIPPED_FRAMES, noBody_, double(skipped));
+        }
+    }
+    started_ = true;
+    lastFrameNumber_ = frameNumber;
+    statistics_.frames++;
+
+    size_t nBodies = std::min(statistics_.bodies.size(), data.size() / QualisysFanout::valuesPerBody);
+    for (size_t b = 0; b < nBodies; b++)
+    {
+        bodyStatistics& body = statistics_.bodies[b];
+        std::vector<bool>::reference alertVisibility = alerted_[b * alertsPerBody_ + 0];
+        std::vector<bool>::reference alertGap = alerted_[b * alertsPerBody_ + 1];
+        std::vector<bool>::reference alertResidual = alerted_[b * alertsPerBody_ + 2];
+
+        // QTM sends NaN for a body it lost
+        bool visible = !std::isnan(data[b * QualisysFanout::valuesPerBody]);
+
+        // visibility, over the whole stream and over the recent frames
+        body.recentVisibility += ((visible ? 1.0 : 0.0) - body.recentVisibility) / recentWindow_;
+        if (visible)
+            body.visibleFrames++;
+        body.visibilityRatio = double(body.visibleFrames) / statistics_.frames;
+
+        if (minVisibility_ > 0 && body.recentVisibility < minVisibility_ && !alertVisibility)
+        {
+            alertVisibility = true;
+            this->alert(QualisysQualityMonitor::ALERT_VISIBILITY, b, body.recentVisibility);
+        }
+        else if (body.recentVisibility >= minVisibility_)
+        {
+            alertVisibility = false;
+        }
+
+        // gaps
+        if (visible)
+        {
+            body.currentGap = 0;
+            alertGap = false;
+        }
+        else
+        {
+            body.currentGap++;
+            body.longestGap = std::max(body.longestGap, body.currentGap);
+            if (maxGap_ > 0 && body.currentGap >= maxGap_ && !alertGap)
+            {
+                alertGap = true;
+                this->alert(QualisysQualityMonitor::ALERT_GAP, b, double(body.currentGap));
+            }
+        }
+
+        // residuals, only for the visible frames
+        if (visible && b < residuals.size() && !std::isnan(residuals[b]))
+        {
+            double residual = residuals[b];
+            residualSum_[b] += residual;
+            residualCount_[b]++;
+            body.residualMean = residualSum_[b] / residualCount_[b];
+            body.residualMax = std::max(body.residualMax, residual);
+
+            if (maxResidual_ > 0 && residual > maxResidual_ && !alertResidual)
+            {
+                alertResidual = true;
+                this->alert(QualisysQualityMonitor::ALERT_RESIDUAL, b, residual);
+            }
+            else if (residual <= maxResidual_)
+            {
+                alertResidual = false;
+            }
+        }
+    }
+}
+
+
+void QualisysQualityMonitor::alert(enumAlerts alert, size_t body, double value)
+{
+    statistics_.alerts++;
+
+    pendingAlert pending;
+    pending.alert = alert;
+    pending.body = body;
+    pending.value = value;
+    pendingAlerts_.push_back(pending);
+}
+
+
+QualisysQualityMonitor::qualityStatistics QualisysQualityMonitor::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(mtxStatistics_);
+    return statistics_;
+}
+
+
+void QualisysQualityMonitor::report()
+{
+    qualityStatistics statistics = this->getStatistics();
+
+    printf("[OK] Quality: %llu frames, %llu skipped, %llu alerts.\n", statistics.frames, statistics.skippedFrames, statistics.alerts);
+    for (std::vector<bodyStatistics>::const_iterator it = statistics.bodies.begin(); it != statistics.bodies.end(); it++)
+    {
+        printf("     %15s : visible %5.1f%%, longest gap %llu frames, residual mean %.2f mm, max %.2f mm\n",
+            it->name.c_str(), 100 * it->visibilityRatio, it->longestGap, it->residualMean, it->residualMax);
+    }
+}
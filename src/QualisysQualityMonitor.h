@@ -0,0 +1,159 @@
+#pragma once
+
+// basic libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+
+// the layout of the frames
+#include "QualisysFanout.h"
+
+
+/**
+ * @brief A class for monitoring the quality of the rigid body data while streaming.
+ *
+ * For every rigid body it counts how often the body is visible (QTM sends NaN for a lost body), the longest gap
+ * and the residuals, and it counts the frames skipped from the gaps in the frame numbers. QualisysConnection polls
+ * the frames (GetCurrentFrame), so a skipped frame is usually a frame which was not polled in time (the loop is
+ * slower than the capture), not a frame lost by QTM or the network.
+ * Everything is computed incrementally, O(bodies) per frame and with a fixed memory, so it can run on every frame.
+ * When a threshold is crossed, an alert is raised (once, until the body is back within the threshold). The alert
+ * function is called by the thread calling update(), after the statistics are unlocked.
+*/
+class QualisysQualityMonitor
+{
+
+
+public:
+
+    enum enumAlerts {
+        ALERT_VISIBILITY,                       //!< The body was visible in less than the minimum ratio of the recent frames.
+        ALERT_GAP,                              //!< The body has been lost for more than the maximum number of frames.
+        ALERT_RESIDUAL,                         //!< The residual of the body is above the maximum.
+        ALERT_SKIPPED_FRAMES                    //!< Frame numbers were skipped (frames not polled, or lost).
+    };
+
+    /**
+     * @brief Function called when an alert is raised (alert, name of the body or empty, value which crossed the threshold).
+    */
+    typedef std::function<void(QualisysQualityMonitor::enumAlerts alert, const std::string& body, double value)> alertFunction;
+
+    /**
+     * @brief Statistics of one rigid body.
+    */
+    struct bodyStatistics {
+        std::string name;                       //!< Name of the rigid body.
+        unsigned long long visibleFrames = 0;   //!< Number of frames in which the body was visible.
+        double visibilityRatio = 0;             //!< visibleFrames / frames.
+        double recentVisibility = 1;            //!< Visibility ratio over the recent frames (moving average).
+        unsigned long long currentGap = 0;      //!< Number of frames since the body was lost (0 if visible).
+        unsigned long long longestGap = 0;      //!< Longest number of consecutive frames in which the body was lost.
+        double residualMean = 0;                //!< Mean residual over the visible frames (in mm).
+        double residualMax = 0;                 //!< Maximum residual over the visible frames (in mm).
+    };
+
+    /**
+     * @brief Statistics of the whole stream.
+    */
+    struct qualityStatistics {
+        unsigned long long frames = 0;          //!< Number of frames received.
+        unsigned long long skippedFrames = 0;   //!< Number of frames missing in the frame numbers (not polled, or lost).
+        unsigned long long alerts = 0;          //!< Number of alerts raised.
+        std::vector<bodyStatistics> bodies;     //!< Statistics of every rigid body.
+    };
+
+    QualisysQualityMonitor();
+
+    /**
+     * @brief Set the rigid bodies to monitor, this resets the statistics.
+    */
+    void setBodies(const std::vector<std::string>& bodies);
+
+    /**
+     * @brief Set the thresholds raising alerts, a threshold of 0 is disabled.
+     *
+     * @param minVisibility Minimum visibility ratio over the recent frames (0 to 1).
+     * @param maxGap Number of consecutive frames a body can be lost before an alert.
+     * @param maxResidual Maximum residual (in mm).
+     * @param maxSkippedFrames Number of frames skipped at once which raises an alert.
+    */
+    void setThresholds(double minVisibility, unsigned long long maxGap, double maxResidual, unsigned long long maxSkippedFrames);
+
+    /**
+     * @brief Set the function called when an alert is raised, by default the alert is printed.
+     *
+     * The function is called by the thread calling update() (the streaming thread), so it should be quick. It is
+     * called without the statistics locked, so it can call getStatistics(). Set it before streaming.
+    */
+    void setAlertFunction(alertFunction function)
+    {
+        alertFunction_ = function;
+    }
+
+    /**
+     * @brief Update the statistics with a new frame.
+     *
+     * A frame with the same frame number as the previous one (polled twice) is ignored.
+     *
+     * @param frameNumber Frame number from Qualisys.
+     * @param data tx, ty, tz, Qw, Qx, Qy, Qz for every rigid body (NaN if lost).
+     * @param residuals Residual of every rigid body (in mm, NaN if lost), can be empty.
+    */
+    void update(unsigned int frameNumber, const std::vector<double>& data, const std::vector<float>& residuals);
+
+    /**
+     * @brief Get a copy of the statistics, can be called from any thread.
+    */
+    qualityStatistics getStatistics();
+
+    /**
+     * @brief Print the statistics.
+    */
+    void report();
+
+
+private:
+
+    /**
+     * @brief An alert raised while the statistics are locked, called once they are unlocked.
+    */
+    struct pendingAlert {
+        enumAlerts alert;                       //!< Type of the alert.
+        size_t body;                            //!< Index of the body, noBody_ for the whole stream (no name copied while streaming).
+        double value;                           //!< Value which crossed the threshold.
+    };
+
+    /**
+     * @brief Update the statistics with a new frame (called with the mutex locked).
+    */
+    void updateStatistics(unsigned int frameNumber, const std::vector<double>& data, const std::vector<float>& residuals);
+
+    /**
+     * @brief Count an alert and queue it for the alert function (called with the mutex locked).
+    */
+    void alert(enumAlerts alert, size_t body, double value);
+
+    std::mutex mtxStatistics_;                  //!< Protects the statistics, read from other threads.
+    qualityStatistics statistics_;              //!< Statistics of the stream.
+    std::vector<double> residualSum_;           //!< Sum of the residuals of every body.
+    std::vector<unsigned long long> residualCount_; //!< Number of residuals summed for every body.
+    std::vector<bool> alerted_;                 //!< A flag per body and per alert, set while the alert is active.
+    std::vector<pendingAlert> pendingAlerts_;   //!< Alerts raised by the last update(), only used by the thread calling update().
+
+    bool started_ = false;                      //!< A flag which specified if a frame was already received.
+    unsigned int lastFrameNumber_ = 0;          //!< Frame number of the last frame.
+
+    double minVisibility_ = 0.9;                //!< Minimum recent visibility ratio (0.9).
+    unsigned long long maxGap_ = 100;           //!< Number of consecutive lost frames before an alert (100).
+    double maxResidual_ = 0;                    //!< Maximum residual in mm (0, disabled).
+    unsigned long long maxSkippedFrames_ = 10;  //!< Number of frames skipped at once which raises an alert (10).
+    const double recentWindow_ = 100;           //!< Number of frames of the moving visibility ratio (100).
+
+    alertFunction alertFunction_;               //!< Function called when an alert is raised.
+
+    static const size_t noBody_ = size_t(-1);  //!< Body index of the alerts of the whole stream.
+    static const size_t alertsPerBody_ = 3;     //!< ALERT_VISIBILITY, ALERT_GAP, ALERT_RESIDUAL.
+
+};
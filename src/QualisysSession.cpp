@@ -0,0 +1,323 @@
+#include "QualisysSession.h"
+#include "QualisysFanout.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+// a line of the manifest with one value per body: "key <tab> value <tab> value ..."
+static void writeValues(std::ostream& file, const std::string& key, const std::vector<double>& values)
+{
+    file << key;
+    for (std::vector<double>::const_iterator it = values.begin(); it != values.end(); it++)
+        file << "\t" << *it;
+    file << "\n";
+}
+
+static void readValues(std::istream& line, const std::string& first, std::vector<double>& values)
+{
+    values.clear();
+    std::string value = first;
+    do
+    {
+        if (!value.empty())
+            values.push_back(std::strtod(value.c_str(), nullptr));
+    } while (std::getline(line, value, '\t'));
+}
+
+
+const std::string QualisysSession::manifestFile = "session.manifest";
+const std::string QualisysSession::indexFile = "rigidbody.idx";
+
+
+std::string QualisysSession::createDirectory(const std::string& recordDirectory, std::string& name)
+{
+    // name the session by its start time, so the sessions are sorted chronologically
+    std::time_t now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", std::localtime(&now));
+
+    // never overwrite a previous session, if there is already a session started in the same second, add a suffix
+    boost::filesystem::path dir = boost::filesystem::path(recordDirectory) / buffer;
+    name = buffer;
+    for (int suffix = 2; boost::filesystem::exists(dir); suffix++)
+    {
+        name = std::string(buffer) + "_" + std::to_string(suffix);
+        dir = boost::filesystem::path(recordDirectory) / name;
+    }
+
+    boost::system::error_code ec;
+    if (!boost::filesystem::create_directories(dir, ec))
+    {
+        std::cout << "[!!] Cannot create session directory: " << dir.string() << " (" << ec.message() << ")" << std::endl;
+        return "";
+    }
+
+    return dir.string();
+}
+
+
+std::vector<QualisysSession::sessionManifest> QualisysSession::listSessions(const std::string& recordDirectory)
+{
+    std::vector<sessionManifest> sessions;
+
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_directory(recordDirectory, ec))
+        return sessions;
+
+    // every directory containing a manifest is a session
+    for (boost::filesystem::directory_iterator it(recordDirectory, ec), end; it != end; it.increment(ec))
+    {
+        if (!boost::filesystem::is_directory(it->path()))
+            continue;
+
+        sessionManifest manifest;
+        if (readManifest(it->path().string(), manifest) == 0)
+            sessions.push_back(manifest);
+    }
+
+    std::sort(sessions.begin(), sessions.end(),
+        [](const sessionManifest& a, const sessionManifest& b) { return a.name < b.name; });
+
+    return sessions;
+}
+
+
+int QualisysSession::writeManifest(const sessionManifest& manifest)
+{
+    boost::filesystem::path path = boost::filesystem::path(manifest.directory) / manifestFile;
+    std::ofstream file(path.string().c_str());
+    if (!file.is_open())
+    {
+        std::cout << "[!!] Cannot write session manifest: " << path.string() << std::endl;
+        return -1;
+    }
+
+    // one "key <tab> value" per line, so it can be read by people and by listSessions()
+    file << std::setprecision(15);
+    file << "Name\t" << manifest.name << "\n";
+    file << "StartTime\t" << manifest.startTime << "\n";
+    file << "StartTimePC\t" << manifest.startTimePC << "\n";
+    file << "DataFile\t" << manifest.dataFile << "\n";
+    file << "IndexFile\t" << indexFile << "\n";
+    file << "FrameRate\t" << manifest.frameRate << "\n";
+    file << "MeasuredFrameRate\t" << manifest.measuredFrameRate << "\n";
+    file << "FrameCount\t" << manifest.frameCount << "\n";
+    file << "IndexInterval\t" << manifest.indexInterval << "\n";
+    file << "FirstTimeQ\t" << manifest.firstTimeQ << "\n";
+    file << "LastTimeQ\t" << manifest.lastTimeQ << "\n";
+    file << "Bodies";
+    for (std::vector<std::string>::const_iterator it = manifest.bodies.begin(); it != manifest.bodies.end(); it++)
+        file << "\t" << *it;
+    file << "\n";
+
+    // summary of the quality of the data, one value per body in the order of "Bodies"
+    file << "SkippedFrames\t" << manifest.skippedFrames << "\n";
+    file << "Alerts\t" << manifest.alerts << "\n";
+    writeValues(file, "Visibility", manifest.visibility);
+    writeValues(file, "LongestGap", manifest.longestGap);
+    writeValues(file, "ResidualMean", manifest.residualMean);
+    writeValues(file, "ResidualMax", manifest.residualMax);
+
+    return 0;
+}
+
+
+int QualisysSession::readManifest(const std::string& directory, sessionManifest& manifest)
+{
+    boost::filesystem::path path = boost::filesystem::path(directory) / manifestFile;
+    std::ifstream file(path.string().c_str());
+    if (!file.is_open())
+        return -1;
+
+    manifest = sessionManifest();
+    manifest.directory = directory;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string key, value;
+        std::getline(ss, key, '\t');
+        std::getline(ss, value, '\t');
+
+        // unknown keys are ignored, so newer manifests can still be read
+        if (key == "Name") manifest.name = value;
+        else if (key == "StartTime") manifest.startTime = value;
+        else if (key == "StartTimePC") manifest.startTimePC = std::atof(value.c_str());
+        else if (key == "DataFile") manifest.dataFile = value;
+        else if (key == "FrameRate") manifest.frameRate = std::atof(value.c_str());
+        else if (key == "MeasuredFrameRate") manifest.measuredFrameRate = std::atof(value.c_str());
+        else if (key == "FrameCount") manifest.frameCount = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "IndexInterval") manifest.indexInterval = std::atoi(value.c_str());
+        else if (key == "FirstTimeQ") manifest.firstTimeQ = std::atof(value.c_str());
+        else if (key == "LastTimeQ") manifest.lastTimeQ = std::atof(value.c_str());
+        else if (key == "SkippedFrames") manifest.skippedFrames = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "Alerts") manifest.alerts = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "Visibility") readValues(ss, value, manifest.visibility);
+        else if (key == "LongestGap") readValues(ss, value, manifest.longestGap);
+        else if (key == "ResidualMean") readValues(ss, value, manifest.residualMean);
+        else if (key == "ResidualMax") readValues(ss, value, manifest.residualMax);
+        else if (key == "Bodies")
+        {
+            if (!value.empty())
+                manifest.bodies.push_back(value);
+            while (std::getline(ss, value, '\t'))
+                manifest.bodies.push_back(value);
+        }
+    }
+
+    return 0;
+}
+
+
+int QualisysSession::writeIndex(const std::string& directory, const std::vector<indexEntry>& index)
+{
+    boost::filesystem::path path = boost::filesystem::path(directory) / indexFile;
+    std::ofstream file(path.string().c_str());
+    if (!file.is_open())
+    {
+        std::cout << "[!!] Cannot write session index: " << path.string() << std::endl;
+        return -1;
+    }
+
+    file << "Frame#\tTimePC\tTimeQ\tOffset\n";
+    file << std::setprecision(15);
+    for (std::vector<indexEntry>::const_iterator it = index.begin(); it != index.end(); it++)
+        file << it->frame << "\t" << it->timePC << "\t" << it->timeQ << "\t" << it->offset << "\n";
+
+    return 0;
+}
+
+
+int QualisysSession::readIndex(const std::string& directory, std::vector<indexEntry>& index)
+{
+    boost::filesystem::path path = boost::filesystem::path(directory) / indexFile;
+    std::ifstream file(path.string().c_str());
+    if (!file.is_open())
+        return -1;
+
+    index.clear();
+
+    // skip the header
+    std::string line;
+    std::getline(file, line);
+
+    indexEntry entry;
+    while (file >> entry.frame >> entry.timePC >> entry.timeQ >> entry.offset)
+        index.push_back(entry);
+
+    return 0;
+}
+
+
+int QualisysSession::open(const std::string& directory)
+{
+    if (readManifest(directory, manifest_) != 0)
+    {
+        std::cout << "[!!] Cannot read session manifest in: " << directory << std::endl;
+        return -1;
+    }
+
+    // a session without index can still be queried, it will just be scanned from the beginning
+    if (readIndex(directory, index_) != 0)
+    {
+        std::cout << "[!!] Cannot read session index in: " << directory << ", the data file will be scanned." << std::endl;
+        index_.clear();
+    }
+
+    return 0;
+}
+
+
+int QualisysSession::query(const std::vector<std::string>& bodies, double timeStart, double timeEnd, std::vector<sessionFrame>& frames)
+{
+    frames.clear();
+
+    // find the columns of the requested bodies
+    std::vector<size_t> columns;
+    if (bodies.empty())
+    {
+        for (size_t i = 0; i < manifest_.bodies.size(); i++)
+            columns.push_back(i);
+    }
+    else
+    {
+        for (std::vector<std::string>::const_iterator it = bodies.begin(); it != bodies.end(); it++)
+        {
+            std::vector<std::string>::const_iterator found = std::find(manifest_.bodies.begin(), manifest_.bodies.end(), *it);
+            if (found == manifest_.bodies.end())
+            {
+                std::cout << "[!!] Unknown rigid body in session " << manifest_.name << ": " << *it << std::endl;
+                return -1;
+            }
+            columns.push_back(found - manifest_.bodies.begin());
+        }
+    }
+
+    boost::filesystem::path path = boost::filesystem::path(manifest_.directory) / manifest_.dataFile;
+    std::ifstream file(path.string().c_str());
+    if (!file.is_open())
+    {
+        std::cout << "[!!] Cannot open session data: " << path.string() << std::endl;
+        return -1;
+    }
+
+    // the times in the query are relative to the first frame, the file has absolute Qualisys time
+    double absoluteStart = manifest_.firstTimeQ + timeStart;
+    double absoluteEnd = manifest_.firstTimeQ + timeEnd;
+
+    // seek to the last indexed frame before the start of the range, without index skip the header (6 lines)
+    std::vector<indexEntry>::const_iterator entry = std::upper_bound(index_.begin(), index_.end(), absoluteStart,
+        [](double time, const indexEntry& e) { return time < e.timeQ; });
+    std::string line;
+    if (entry != index_.begin())
+    {
+        file.seekg(std::streamoff((entry - 1)->offset));
+    }
+    else
+    {
+        for (int i = 0; i < 6 && std::getline(file, line); i++);
+    }
+
+    // read row by row until the end of the range
+    std::vector<double> row;
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        sessionFrame frame;
+        if (!(ss >> frame.frame >> frame.timePC >> frame.timeQ))
+            continue;
+
+        if (frame.timeQ < absoluteStart)
+            continue;
+        if (frame.timeQ > absoluteEnd)
+            break;
+
+        // read the values with strtod, lost bodies are written as nan which operator>> does not accept
+        row.clear();
+        std::string token;
+        while (std::getline(ss, token, '\t'))
+        {
+            if (!token.empty())
+                row.push_back(std::strtod(token.c_str(), nullptr));
+        }
+
+        frame.data.reserve(columns.size() * QualisysFanout::valuesPerBody);
+        for (std::vector<size_t>::const_iterator it = columns.begin(); it != columns.end(); it++)
+        {
+            size_t first = *it * QualisysFanout::valuesPerBody;
+            if (first + QualisysFanout::valuesPerBody > row.size())
+                break;
+            frame.data.insert(frame.data.end(), row.begin() + first, row.begin() + first + QualisysFanout::valuesPerBody);
+        }
+
+        frames.push_back(frame);
+    }
+
+    return 0;
+}
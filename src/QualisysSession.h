@@ -0,0 +1,148 @@
+#pragma once
+
+// basic libraries
+#include <iostream>
+#include <string>
+#include <vector>
+
+// library from boost, to manage file
+// https://www.boost.org/users/download/
+#include <boost/filesystem.hpp>
+
+
+/**
+ * @brief A class for managing recorded sessions.
+ *
+ * Every recording is stored in its own directory (named by its start time) under the record directory,
+ * together with a manifest (start time, body list, rate, frame count) and a sparse index which stores
+ * the file offset of every N-th frame. With the index, a time range can be read by seeking into the
+ * data file instead of scanning the whole file.
+*/
+class QualisysSession
+{
+
+
+public:
+
+    /**
+     * @brief One entry of the sparse index, the position of a frame in the data file.
+    */
+    struct indexEntry {
+        unsigned long long frame;               //!< Frame number (row number in the data file).
+        double timePC;                          //!< timestamp when the frame arrived to PC (in seconds).
+        double timeQ;                           //!< timestamp from Qualisys (in seconds).
+        unsigned long long offset;              //!< Offset of the row in the data file (in bytes).
+    };
+
+    /**
+     * @brief Content of the manifest of a session.
+    */
+    struct sessionManifest {
+        std::string name;                       //!< Name of the session (also the name of its directory).
+        std::string directory;                  //!< Full path of the session directory.
+        std::string startTime;                  //!< Local time when the recording started (YYYY-MM-DD HH:MM:SS).
+        double startTimePC = 0;                 //!< PC timestamp when the recording started (in seconds).
+        std::string dataFile;                   //!< Name of the data file, relative to the session directory.
+        std::vector<std::string> bodies;        //!< List of the rigid bodies, in the order of the data file.
+        double frameRate = 0;                   //!< Expected frame rate of QTM (in Hz).
+        double measuredFrameRate = 0;           //!< Frame rate computed from the Qualisys timestamps (in Hz).
+        unsigned long long frameCount = 0;      //!< Number of frames recorded.
+        unsigned int indexInterval = 0;         //!< Number of frames between two entries of the index.
+        double firstTimeQ = 0;                  //!< Qualisys timestamp of the first frame (in seconds).
+        double lastTimeQ = 0;                   //!< Qualisys timestamp of the last frame (in seconds).
+
+        unsigned long long skippedFrames = 0;   //!< Number of frames skipped in the frame numbers (not polled, or lost).
+        unsigned long long alerts = 0;          //!< Number of quality alerts raised during the recording.
+        std::vector<double> visibility;         //!< Visibility ratio of every body (same order as bodies).
+        std::vector<double> longestGap;         //!< Longest gap of every body (in frames).
+        std::vector<double> residualMean;       //!< Mean residual of every body (in mm).
+        std::vector<double> residualMax;        //!< Maximum residual of every body (in mm).
+    };
+
+    /**
+     * @brief One frame returned by a query.
+    */
+    struct sessionFrame {
+        unsigned long long frame;               //!< Frame number.
+        double timePC;                          //!< timestamp when the frame arrived to PC (in seconds).
+        double timeQ;                           //!< timestamp from Qualisys (in seconds).
+        std::vector<double> data;               //!< tx, ty, tz, Qw, Qx, Qy, Qz of every requested body.
+    };
+
+    /**
+     * @brief Create a new, unique, session directory under the record directory.
+     *
+     * @param recordDirectory Directory in which all the sessions are stored.
+     * @param name Returns the name of the session.
+     * @return Full path of the session directory, empty if it can not be created.
+    */
+    static std::string createDirectory(const std::string& recordDirectory, std::string& name);
+
+    /**
+     * @brief List all the sessions stored in the record directory, sorted by name (i.e. start time).
+    */
+    static std::vector<sessionManifest> listSessions(const std::string& recordDirectory);
+
+    /**
+     * @brief Write the manifest of a session in its directory.
+     * @return 0 success, -1 error occured.
+    */
+    static int writeManifest(const sessionManifest& manifest);
+
+    /**
+     * @brief Read the manifest of the session stored in the directory.
+     * @return 0 success, -1 error occured.
+    */
+    static int readManifest(const std::string& directory, sessionManifest& manifest);
+
+    /**
+     * @brief Write the sparse index of a session in its directory.
+     * @return 0 success, -1 error occured.
+    */
+    static int writeIndex(const std::string& directory, const std::vector<indexEntry>& index);
+
+    /**
+     * @brief Read the sparse index of the session stored in the directory.
+     * @return 0 success, -1 error occured.
+    */
+    static int readIndex(const std::string& directory, std::vector<indexEntry>& index);
+
+
+    /**
+     * @brief Open a recorded session for querying.
+     *
+     * @param directory Full path of the session directory.
+     * @return 0 success, -1 error occured.
+    */
+    int open(const std::string& directory);
+
+    /**
+     * @brief Get the manifest of the opened session.
+    */
+    sessionManifest getManifest()
+    {
+        return manifest_;
+    }
+
+    /**
+     * @brief Read the frames of some rigid bodies in a time range.
+     *
+     * @param bodies Names of the rigid bodies, all the bodies if empty.
+     * @param timeStart Start of the range, in seconds since the first frame (Qualisys time).
+     * @param timeEnd End of the range, in seconds since the first frame (Qualisys time).
+     * @param frames Returns the frames in the range.
+     * @return 0 success, -1 error occured.
+    */
+    int query(const std::vector<std::string>& bodies, double timeStart, double timeEnd, std::vector<sessionFrame>& frames);
+
+
+    static const std::string manifestFile;      //!< Name of the manifest file in a session directory.
+    static const std::string indexFile;         //!< Name of the index file in a session directory.
+
+
+private:
+
+    sessionManifest manifest_;                  //!< Manifest of the opened session.
+    std::vector<indexEntry> index_;             //!< Sparse index of the opened session.
+
+};
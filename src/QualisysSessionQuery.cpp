@@ -0,0 +1,81 @@
+// QualisysSessionQuery.cpp : Command line tool to list the recorded sessions and read a time range of them.
+//
+// Examples:
+//   QualisysSessionQuery D:/qualisyslog --list
+//   QualisysSessionQuery D:/qualisyslog --session 20221020_101500 --body pointer --body femur --from 10 --to 12.5
+//
+
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include "QualisysSession.h"
+
+// dependencies
+#include <tclap/CmdLine.h>
+
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		TCLAP::CmdLine cmd("List the recorded Qualisys sessions, or print the frames of some rigid bodies in a time range.", ' ', "1.0");
+		TCLAP::UnlabeledValueArg<std::string> argDirectory("directory", "Record directory containing the sessions.", true, "", "directory", cmd);
+		TCLAP::SwitchArg argList("l", "list", "List the sessions in the record directory.", cmd, false);
+		TCLAP::ValueArg<std::string> argSession("s", "session", "Name of the session to read.", false, "", "name", cmd);
+		TCLAP::MultiArg<std::string> argBody("b", "body", "Rigid body to read (can be repeated, all bodies if not specified).", false, "name", cmd);
+		TCLAP::ValueArg<double> argFrom("f", "from", "Start of the range, in seconds since the start of the session.", false, 0, "seconds", cmd);
+		TCLAP::ValueArg<double> argTo("t", "to", "End of the range, in seconds since the start of the session.", false, std::numeric_limits<double>::max(), "seconds", cmd);
+		cmd.parse(argc, argv);
+
+		// list all the sessions in the catalog
+		if (argList.getValue() || argSession.getValue().empty())
+		{
+			std::vector<QualisysSession::sessionManifest> sessions = QualisysSession::listSessions(argDirectory.getValue());
+			std::cout << "Name\tStartTime\tFrameRate\tFrameCount\tSkipped\tAlerts\tDuration\tBodies" << std::endl;
+			for (std::vector<QualisysSession::sessionManifest>::const_iterator it = sessions.begin(); it != sessions.end(); it++)
+			{
+				std::cout << it->name << "\t" << it->startTime << "\t" << it->measuredFrameRate << "\t" << it->frameCount << "\t"
+					<< it->skippedFrames << "\t" << it->alerts << "\t" << (it->lastTimeQ - it->firstTimeQ) << "\t";
+				for (std::vector<std::string>::const_iterator body = it->bodies.begin(); body != it->bodies.end(); body++)
+					std::cout << *body << " ";
+				std::cout << std::endl;
+			}
+			return 0;
+		}
+
+		// read a time range of one session
+		QualisysSession session;
+		boost::filesystem::path directory = boost::filesystem::path(argDirectory.getValue()) / argSession.getValue();
+		if (session.open(directory.string()) != 0)
+			return -1;
+
+		std::vector<std::string> bodies = argBody.getValue();
+		std::vector<QualisysSession::sessionFrame> frames;
+		if (session.query(bodies, argFrom.getValue(), argTo.getValue(), frames) != 0)
+			return -1;
+
+		if (bodies.empty())
+			bodies = session.getManifest().bodies;
+
+		std::cout << "Frame#\tTimePC\tTimeQ";
+		for (std::vector<std::string>::const_iterator it = bodies.begin(); it != bodies.end(); it++)
+			std::cout << "\t" << *it << "_tx\t" << *it << "_ty\t" << *it << "_tz\t" << *it << "_Qw\t" << *it << "_Qx\t" << *it << "_Qy\t" << *it << "_Qz";
+		std::cout << std::endl;
+
+		std::cout << std::setprecision(15);
+		for (std::vector<QualisysSession::sessionFrame>::const_iterator it = frames.begin(); it != frames.end(); it++)
+		{
+			std::cout << it->frame << "\t" << it->timePC << "\t" << it->timeQ;
+			for (std::vector<double>::const_iterator value = it->data.begin(); value != it->data.end(); value++)
+				std::cout << "\t" << *value;
+			std::cout << std::endl;
+		}
+	}
+	catch (TCLAP::ArgException& e)
+	{
+		std::cerr << "[!!] " << e.error() << " for arg " << e.argId() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -26,6 +26,18 @@ int main()
 	// by specifying command above, streaming mode automatically set to STREAM_USING_COMMAND
 	// however, you can still specify how you want to stream here. for debugging purposes, i used STREAM_USING_NOTHING
 	myQualisysConnection.setStreamingMode(QualisysConnection::STREAM_USING_NOTHING);
+	// specify how the thread waits for data. WAIT_USING_SPIN gives the lowest latency but burns a full core,
+	// WAIT_USING_BLOCKING lets the CPU idle (e.g. laptop on battery), its timeout is derived from the frame rate.
+	myQualisysConnection.setWaitStrategy(QualisysConnection::WAIT_USING_SPIN);
+	myQualisysConnection.setFrameRate(100);
+	// add consumers which need a lower rate than the capture (the logger always receives every frame), e.g. a UI at 60 Hz:
+	// myQualisysConnection.addSink("ui", 60, QualisysFanout::DECIMATE_USING_AVERAGE,
+	//	[](const double& timePC, const double& timeQ, const std::vector<double>& data) { /* update the UI */ });
+	// re-broadcast the frames to other machines of the lab (UDP multicast group and TCP port), see QualisysPoseReceiver
+	// myQualisysConnection.startPoseServer("239.255.42.99", 45454, 45455);
+	// alert if a rigid body is visible in less than 90% of the recent frames, lost for 100 frames, has a residual above 2 mm,
+	// or if 10 frames are skipped at once (not polled in time). The statistics are also written in the session manifest.
+	myQualisysConnection.setQualityThresholds(0.9, 100, 2.0, 10);
 
 
 	std::thread threadQualisys(std::ref(myQualisysConnection));
@@ -0,0 +1,229 @@
+// QualisysPoseLoopbackTest.cpp : Loopback test of QualisysPoseServer and QualisysPoseClient.
+//
+// A server publishes known frames (with lost bodies, i.e. NaN) to a multicast group and to a TCP port on this
+// machine, and a client of each kind checks the sequence numbers, both timestamps, the values and the names of the
+// rigid bodies. Returns 0 if everything was received as published.
+//
+
+#include <iostream>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "QualisysPoseServer.h"
+#include "QualisysPoseClient.h"
+
+
+static const std::string multicastAddress = "239.255.42.99";
+static const unsigned short udpPort = 45464;
+static const unsigned short tcpPort = 45465;
+static const std::vector<std::string> bodies = { "pointer", "femur" };
+
+
+/**
+ * @brief Frame published with a sequence number, the femur is lost in every odd frame.
+*/
+static void expectedFrame(uint32_t sequence, double& timePC, double& timeQ, std::vector<double>& data)
+{
+	timePC = 1000.0 + 0.01 * sequence;
+	timeQ = 0.5 + 0.01 * sequence;
+
+	double femur = (sequence % 2) ? std::nan("") : 1.5;
+	data = { 0.001 * sequence, -0.002 * sequence, 0.25, 1, 0, 0, 0,
+	         femur, femur, femur, femur, femur, femur, femur };
+	if (!(sequence % 2))
+	{
+		// a valid quaternion for the visible femur
+		data[10] = 0;
+		data[11] = 1;
+		data[12] = 0;
+		data[13] = 0;
+	}
+}
+
+
+/**
+ * @brief Compare a received frame with the one published with the same sequence number.
+ * @return 0 same, -1 different.
+*/
+static int checkFrame(const char* transport, const QualisysPoseClient::poseFrame& frame)
+{
+	double timePC, timeQ;
+	std::vector<double> data;
+	expectedFrame(frame.sequence, timePC, timeQ, data);
+
+	// the timestamps are sent as double, the values as float
+	if (frame.timePC != timePC || frame.timeQ != timeQ)
+	{
+		printf("[!!] %s: frame %u, wrong timestamps %.6f %.6f.\n", transport, frame.sequence, frame.timePC, frame.timeQ);
+		return -1;
+	}
+	if (frame.data.size() != data.size())
+	{
+		printf("[!!] %s: frame %u, %zu values instead of %zu.\n", transport, frame.sequence, frame.data.size(), data.size());
+		return -1;
+	}
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		bool same = std::isnan(data[i]) ? std::isnan(frame.data[i]) : (frame.data[i] == double(float(data[i])));
+		if (!same)
+		{
+			printf("[!!] %s: frame %u, value %zu is %f instead of %f.\n", transport, frame.sequence, i, frame.data[i], data[i]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Receive some frames and check them.
+ * @param consecutive The sequence numbers must follow each other (TCP), otherwise only increase (UDP).
+ * @return number of errors.
+*/
+static int receiveFrames(const char* transport, QualisysPoseClient& client, int count, bool consecutive)
+{
+	QualisysPoseClient::poseFrame frame;
+	uint32_t first = 0, last = 0;
+	int errors = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (client.receive(frame) != 0)
+		{
+			printf("[!!] %s: receive failed after %d frames.\n", transport, i);
+			return errors + 1;
+		}
+
+		if (i == 0)
+			first = frame.sequence;
+		else if ((consecutive && frame.sequence != last + 1) || (!consecutive && frame.sequence <= last))
+		{
+			printf("[!!] %s: frame %u received after frame %u.\n", transport, frame.sequence, last);
+			errors++;
+		}
+		last = frame.sequence;
+
+		if (checkFrame(transport, frame) != 0)
+			errors++;
+	}
+
+	// udp clients get the description regularly, keep receiving until it came
+	for (int i = 0; client.getBodies().empty() && i < 1000; i++)
+	{
+		if (client.receive(frame) != 0)
+			break;
+	}
+
+	if (client.getBodies() != bodies)
+	{
+		printf("[!!] %s: wrong description (%zu bodies).\n", transport, client.getBodies().size());
+		errors++;
+	}
+	if (consecutive && client.getLostFrames() != 0)
+	{
+		printf("[!!] %s: %llu frames lost.\n", transport, client.getLostFrames());
+		errors++;
+	}
+
+	printf("[OK] %s: frames %u to %u received, %llu lost, %d errors.\n", transport, first, last, client.getLostFrames(), errors);
+	return errors;
+}
+
+
+/**
+ * @brief A header announcing a packet bigger than any valid one must be rejected (the TCP client allocates this size).
+ * @return number of errors.
+*/
+static int checkOversizedHeader()
+{
+	double timePC, timeQ;
+	std::vector<double> data;
+	std::vector<uint8_t> buffer;
+	expectedFrame(0, timePC, timeQ, data);
+	QualisysPosePacket::encodeFrame(buffer, 0, timePC, timeQ, data);
+
+	// size field at offset 8, little-endian
+	buffer[8] = buffer[9] = buffer[10] = buffer[11] = 0xFF;
+
+	QualisysPosePacket::packetHeader header;
+	if (QualisysPosePacket::decodeHeader(buffer.data(), buffer.size(), header) == 0)
+	{
+		printf("[!!] Header with a size of %u bytes accepted.\n", header.size);
+		return 1;
+	}
+	return 0;
+}
+
+
+int main()
+{
+	if (checkOversizedHeader() != 0)
+		return 1;
+
+	// a blocking receive never returns if the packets do not arrive, do not let the test hang
+	std::atomic<bool> done(false);
+	std::thread watchdog([&done]()
+	{
+		for (int i = 0; i < 300 && !done; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (!done)
+		{
+			printf("[!!] Timeout, frames not received.\n");
+			std::_Exit(1);
+		}
+	});
+
+	QualisysPoseServer server;
+	server.setBodies(bodies);
+	if (server.startUDP(multicastAddress, udpPort) != 0 || server.startTCP(tcpPort) != 0)
+	{
+		done = true;
+		watchdog.join();
+		return 1;
+	}
+
+	QualisysPoseClient clientUDP, clientTCP;
+	if (clientUDP.connectUDP(multicastAddress, udpPort) != 0 || clientTCP.connectTCP("127.0.0.1", tcpPort) != 0)
+	{
+		done = true;
+		watchdog.join();
+		return 1;
+	}
+
+	// publish as QualisysConnection does, from its own thread, until both clients are done
+	std::atomic<bool> stop(false);
+	std::thread publisher([&server, &stop]()
+	{
+		double timePC, timeQ;
+		std::vector<double> data;
+		for (uint32_t sequence = 0; !stop; sequence++)
+		{
+			expectedFrame(sequence, timePC, timeQ, data);
+			server.publish(timePC, timeQ, data);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	int errors = 0;
+	errors += receiveFrames("TCP", clientTCP, 300, true);
+	errors += receiveFrames("UDP", clientUDP, 100, false);
+
+	stop = true;
+	publisher.join();
+	server.stop();
+	server.report();
+
+	// the server closed the connection, the client must see it instead of waiting forever
+	QualisysPoseClient::poseFrame frame;
+	while (clientTCP.receive(frame) == 0)
+		;
+	clientUDP.close();
+
+	done = true;
+	watchdog.join();
+
+	printf("%s Pose loopback test: %d errors.\n", (errors == 0) ? "[OK]" : "[!!]", errors);
+	return (errors == 0) ? 0 : 1;
+}